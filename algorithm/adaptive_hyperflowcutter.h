@@ -0,0 +1,218 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tbb/global_control.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/task_arena.h>
+#include <tbb/tick_count.h>
+#include <tuple>
+
+#include "hyperflowcutter.h"
+#include "parallel_push_relabel.h"
+#include "sequential_push_relabel.h"
+
+namespace whfc {
+
+    enum class FlowEngine : uint8_t { Sequential = 0, Parallel = 1 };
+
+    // cheap features of a flow problem that the engine choice depends on
+    struct FlowProblemFeatures {
+        size_t num_nodes = 0, num_hyperedges = 0, num_pins = 0;
+        size_t max_degree = 0;
+        Flow min_capacity = 0, max_capacity = 0;
+
+        static FlowProblemFeatures compute(const FlowHypergraph& hg) {
+            FlowProblemFeatures f;
+            f.num_nodes = hg.numNodes();
+            f.num_hyperedges = hg.numHyperedges();
+            f.num_pins = hg.numPins();
+            f.max_capacity = hg.maxHyperedgeCapacity;
+            f.max_degree = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, hg.numNodes(), 1 << 12), size_t(0),
+                    [&](const tbb::blocked_range<size_t>& r, size_t m) {
+                        for (size_t u = r.begin(); u < r.end(); ++u) {
+                            m = std::max(m, size_t(hg.degree(Node(u))));
+                        }
+                        return m;
+                    },
+                    [](size_t a, size_t b) { return std::max(a, b); });
+            f.min_capacity = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, hg.numHyperedges(), 1 << 12), f.max_capacity,
+                    [&](const tbb::blocked_range<size_t>& r, Flow m) {
+                        for (size_t e = r.begin(); e < r.end(); ++e) {
+                            m = std::min(m, hg.capacity(Hyperedge(e)));
+                        }
+                        return m;
+                    },
+                    [](Flow a, Flow b) { return std::min(a, b); });
+            return f;
+        }
+    };
+
+    /*
+     * Predicts the faster engine for a flow problem and calibrates online from recorded timings. Problems are grouped into classes by
+     * log2(#pins), by how skewed the degrees are (log2 of max over average degree) and by the capacity spread (log2 of max over min capacity).
+     * Per class and engine, an exponential moving average of seconds per pin is kept, and the engine with the smaller average is chosen.
+     * Until both engines have exploration_samples measurements in a class, the engine with fewer measurements is chosen,
+     * and for classes without any measurements a static rule decides: parallel from prior_parallel_min_pins pins on.
+     * With a single thread, in the arena of the caller or by global_control, it always chooses the sequential engine.
+     * Thread-safe, so that concurrent cutters can share it.
+     */
+    class FlowEngineSelector {
+    public:
+        size_t exploration_samples = 1;
+        size_t prior_parallel_min_pins = 100000;
+        double smoothing = 0.3; // weight of a new measurement
+        bool single_thread_exploration = false; // lets the selector choose the parallel engine with a single thread, for testing
+
+        using ProblemClass = std::tuple<uint32_t, uint32_t, uint32_t>;
+
+        static ProblemClass problemClass(const FlowProblemFeatures& f) {
+            const double avg_degree = f.num_nodes > 0 ? std::max(1.0, double(f.num_pins) / double(f.num_nodes)) : 1.0;
+            const double capacity_spread = f.min_capacity > 0 ? double(f.max_capacity) / double(f.min_capacity) : 1.0;
+            return { floorLog2(f.num_pins), std::min<uint32_t>(floorLog2(size_t(double(f.max_degree) / avg_degree)), 8),
+                     std::min<uint32_t>(floorLog2(size_t(capacity_spread)) / 2, 4) };
+        }
+
+        FlowEngine select(const FlowProblemFeatures& f) const {
+            const size_t threads = std::min<size_t>(tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism),
+                                                    size_t(tbb::this_task_arena::max_concurrency()));
+            if (threads <= 1 && !single_thread_exploration) {
+                return FlowEngine::Sequential;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = classes.find(problemClass(f));
+            if (it == classes.end()) {
+                return prior(f);
+            }
+            const Measurements& m = it->second;
+            for (FlowEngine engine : { prior(f), other(prior(f)) }) {
+                if (m.samples[index(engine)] < exploration_samples) {
+                    return engine;
+                }
+            }
+            return m.seconds_per_pin[index(FlowEngine::Parallel)] < m.seconds_per_pin[index(FlowEngine::Sequential)] ? FlowEngine::Parallel
+                                                                                                                         : FlowEngine::Sequential;
+        }
+
+        void record(const FlowProblemFeatures& f, FlowEngine engine, double seconds) {
+            const double x = seconds / double(std::max<size_t>(f.num_pins, 1));
+            std::lock_guard<std::mutex> lock(mutex);
+            Measurements& m = classes[problemClass(f)];
+            double& avg = m.seconds_per_pin[index(engine)];
+            avg = m.samples[index(engine)] == 0 ? x : smoothing * x + (1.0 - smoothing) * avg;
+            m.samples[index(engine)]++;
+        }
+
+        // number of recorded runs of the engine in the class of f
+        size_t samples(const FlowProblemFeatures& f, FlowEngine engine) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = classes.find(problemClass(f));
+            return it == classes.end() ? 0 : it->second.samples[index(engine)];
+        }
+
+    private:
+        struct Measurements {
+            double seconds_per_pin[2] = { 0.0, 0.0 };
+            size_t samples[2] = { 0, 0 };
+        };
+
+        static uint32_t floorLog2(size_t x) {
+            uint32_t l = 0;
+            while (x > 1) {
+                x >>= 1;
+                l++;
+            }
+            return l;
+        }
+
+        static size_t index(FlowEngine e) { return static_cast<size_t>(e); }
+        static FlowEngine other(FlowEngine e) { return e == FlowEngine::Sequential ? FlowEngine::Parallel : FlowEngine::Sequential; }
+        FlowEngine prior(const FlowProblemFeatures& f) const { return f.num_pins >= prior_parallel_min_pins ? FlowEngine::Parallel : FlowEngine::Sequential; }
+
+        mutable std::mutex mutex;
+        std::map<ProblemClass, Measurements> classes;
+    };
+
+    /*
+     * HyperFlowCutter that picks SequentialPushRelabel or ParallelPushRelabel per run with a FlowEngineSelector, and reports the time of the run
+     * back to it. The cutters of both engines are created on first use and work on the same hypergraph. Settings are applied to the chosen cutter
+     * at the start of each run. After a run, the partition is in sequentialCutter() or parallelCutter(), as lastEngine() says.
+     */
+    class AdaptiveHyperFlowCutter {
+    public:
+        bool find_most_balanced = true;
+
+        AdaptiveHyperFlowCutter(FlowHypergraph& hg, int seed, FlowEngineSelector& selector, bool deterministic = false) :
+            hg(hg), selector(selector), seed(seed), deterministic(deterministic) {}
+
+        void setMaxBlockWeight(int side, NodeWeight w) { max_block_weight[side] = w; }
+        void setFlowBound(Flow bound) { flow_bound = bound; }
+        void setBulkPiercing(bool use) { bulk_piercing = use; }
+        void setArena(tbb::task_arena* a) { arena = a; }
+
+        FlowEngine lastEngine() const { return last_engine; }
+
+        HyperFlowCutter<SequentialPushRelabel>& sequentialCutter() { return getCutter(sequential); }
+        HyperFlowCutter<ParallelPushRelabel>& parallelCutter() { return getCutter(parallel); }
+
+        // the flow value of the last run
+        Flow flowValue() const {
+            return last_engine == FlowEngine::Sequential ? sequential->cs.flow_algo.flow_value : parallel->cs.flow_algo.flow_value;
+        }
+
+        bool enumerateCutsUntilBalancedOrFlowBoundExceeded(const Node s, const Node t) {
+            if (arena) {
+                return arena->execute([&] { return enumerate(s, t); });
+            }
+            return enumerate(s, t);
+        }
+
+    private:
+        bool enumerate(const Node s, const Node t) {
+            const FlowProblemFeatures features = FlowProblemFeatures::compute(hg);
+            last_engine = selector.select(features);
+            return last_engine == FlowEngine::Sequential ? run(getCutter(sequential), features, s, t) : run(getCutter(parallel), features, s, t);
+        }
+
+        template<typename FlowAlgorithm>
+        HyperFlowCutter<FlowAlgorithm>& getCutter(std::unique_ptr<HyperFlowCutter<FlowAlgorithm>>& hfc) {
+            if (!hfc) {
+                hfc = std::make_unique<HyperFlowCutter<FlowAlgorithm>>(hg, seed, deterministic);
+            }
+            return *hfc;
+        }
+
+        template<typename FlowAlgorithm>
+        bool run(HyperFlowCutter<FlowAlgorithm>& hfc, const FlowProblemFeatures& features, const Node s, const Node t) {
+            hfc.reset();
+            hfc.cs.setMaxBlockWeight(0, max_block_weight[0]);
+            hfc.cs.setMaxBlockWeight(1, max_block_weight[1]);
+            hfc.setFlowBound(flow_bound);
+            hfc.setBulkPiercing(bulk_piercing);
+            hfc.find_most_balanced = find_most_balanced;
+            const auto start = tbb::tick_count::now();
+            const bool result = hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(s, t);
+            if (!hfc.cs.flow_algo.shall_terminate) { // aborted runs say nothing about the engine
+                selector.record(features, last_engine, (tbb::tick_count::now() - start).seconds());
+            }
+            return result;
+        }
+
+        FlowHypergraph& hg;
+        FlowEngineSelector& selector;
+        int seed;
+        bool deterministic;
+        std::unique_ptr<HyperFlowCutter<SequentialPushRelabel>> sequential;
+        std::unique_ptr<HyperFlowCutter<ParallelPushRelabel>> parallel;
+        FlowEngine last_engine = FlowEngine::Sequential;
+
+        NodeWeight max_block_weight[2] = { NodeWeight(0), NodeWeight(0) };
+        Flow flow_bound = std::numeric_limits<Flow>::max();
+        bool bulk_piercing = true;
+        tbb::task_arena* arena = nullptr;
+    };
+
+} // namespace whfc
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "parallel_push_relabel.h"
+
+#include <atomic>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_for_each.h>
+#include <tbb/tick_count.h>
+
+namespace whfc {
+
+    /*
+     * Asynchronous push-relabel without synchronous rounds. Active nodes are discharged as tasks of tbb::parallel_for_each, whose feeder
+     * puts newly activated nodes into the work-stealing deque of the current thread. cf. Hong and He, Baumstark et al.
+     *
+     * A node is claimed (last_activated[u] == round) while it is queued or discharged, so only one thread discharges it at a time.
+     * Flow on an edge is only increased by its tail and only decreased by its head, and excesses only grow concurrently,
+     * so atomic updates keep capacities and excesses valid without locking. Levels only grow between global relabelings.
+     * Global relabeling is the only barrier: once enough work is done, the remaining tasks are parked and resumed afterwards.
+     * Cut derivation, reachability and the termination check are shared with BasicParallelPushRelabel.
+     */
+    template<typename FlowStorage = Flow, typename LevelStorage = int>
+    class BasicAsyncPushRelabel : public BasicParallelPushRelabel<FlowStorage, LevelStorage> {
+    public:
+        using Base = BasicParallelPushRelabel<FlowStorage, LevelStorage>;
+        using Base::hg;
+        using Base::flow;
+        using Base::excess;
+        using Base::level;
+        using Base::max_level;
+        using Base::flow_value;
+        using Base::upper_flow_bound;
+        using Base::shall_terminate;
+        using Base::global_relabel_time;
+        using Base::discharge_time;
+        using Base::saturate_time;
+        using Base::source_cut_time;
+        using Base::isHypernode;
+        using Base::isOutNode;
+        using Base::inNodeToEdge;
+        using Base::outNodeToEdge;
+        using Base::edgeToInNode;
+        using Base::edgeToOutNode;
+        using Base::inNodeIncidenceIndex;
+        using Base::outNodeIncidenceIndex;
+        using Base::bridgeEdgeIndex;
+        using Base::isTarget;
+        using Base::work_since_last_global_relabel;
+        using Base::global_relabel_work_threshold;
+        using Base::distance_labels_broken_from_target_side_piercing;
+        using Base::initialize;
+        using Base::reset;
+        using Base::touchAtomic;
+        using Base::saturateSourceEdges;
+        using Base::deriveSourceSideCut;
+        using Base::num_active;
+        using Base::next_active;
+        using Base::active;
+        using Base::last_activated;
+        using Base::round;
+        using Base::instrumentation;
+
+        static constexpr bool log = false;
+
+        explicit BasicAsyncPushRelabel(FlowHypergraph& hg) : Base(hg) {}
+
+        bool findMinCuts() {
+            if (!augmentFlow()) {
+                return false;
+            }
+            auto t = tbb::tick_count::now();
+            deriveSourceSideCut(true);
+            auto t2 = tbb::tick_count::now();
+            source_cut_time += (t2 - t).seconds();
+            return true;
+        }
+
+        Flow computeMaxFlow(Node s, Node t) {
+            reset();
+            initialize(s, t);
+            augmentFlow();
+            return flow_value;
+        }
+
+        bool augmentFlow() {
+            auto t = tbb::tick_count::now();
+            saturateSourceEdges();
+            auto t2 = tbb::tick_count::now();
+            saturate_time += (t2 - t).seconds();
+            do {
+                while (!next_active.empty()) {
+                    if (flow_value > upper_flow_bound || shall_terminate) {
+                        return false;
+                    }
+                    num_active = next_active.size();
+                    next_active.swap_container(active);
+
+                    if (distance_labels_broken_from_target_side_piercing || work_since_last_global_relabel > global_relabel_work_threshold) {
+                        Base::template globalRelabel<false>();
+                    }
+
+                    auto t3 = tbb::tick_count::now();
+                    dischargeAsync();
+                    discharge_time += (tbb::tick_count::now() - t3).seconds();
+                }
+
+                // same termination check as the synchronous variant. all nodes are released at this point
+                num_active = 0;
+                Base::template globalRelabel<true>();
+                next_active.swap_container(active);
+                next_active.set_size(num_active);
+            } while (!next_active.empty());
+            return true;
+        }
+
+        // runs until no node is active, or until the global relabeling work threshold is reached. parked nodes stay claimed and end up in next_active
+        void dischargeAsync() {
+            auto phase = instrumentation.scope(PushRelabelPhase::Discharge);
+            tbb::parallel_for<size_t>(0UL, num_active, [&](size_t i) { last_activated[active[i]] = round; });
+            next_active.clear();
+            park.store(false, std::memory_order_relaxed);
+            const size_t work_budget =
+                    global_relabel_work_threshold > work_since_last_global_relabel ? global_relabel_work_threshold - work_since_last_global_relabel : 0;
+            std::atomic<size_t> total_work{ 0 };
+            tbb::enumerable_thread_specific<size_t> local_work(0);
+
+            auto task = [&](Node u, tbb::feeder<Node>& feeder) {
+                if (park.load(std::memory_order_relaxed)) {
+                    next_active.push_back_buffered(u);
+                    return;
+                }
+                size_t work = 0;
+                if (level[u] < max_level && !isTarget(u)) {
+                    if (isHypernode(u)) {
+                        work = dischargeHypernode(u, feeder);
+                    } else if (isOutNode(u)) {
+                        work = dischargeOutNode(u, feeder);
+                    } else {
+                        work = dischargeInNode(u, feeder);
+                    }
+                }
+                instrumentation.local(PushRelabelPhase::Discharge).activeNodes(1); // nodes fed during the round count as well
+                release(u);
+                // excess that arrived after the last look, while u was still claimed. the pusher could not claim u, so we take it again
+                if (__atomic_load_n(&excess[u], __ATOMIC_SEQ_CST) > 0 && level[u] < max_level && claim(u)) {
+                    feeder.add(u);
+                }
+
+                size_t& w = local_work.local();
+                w += work;
+                if (w >= work_flush_interval) {
+                    const size_t total = total_work.fetch_add(w, std::memory_order_relaxed) + w;
+                    w = 0;
+                    if (total > work_budget || shall_terminate || __atomic_load_n(&flow_value, __ATOMIC_RELAXED) > upper_flow_bound) {
+                        park.store(true, std::memory_order_relaxed);
+                    }
+                }
+            };
+            tbb::parallel_for_each(active.begin(), active.begin() + num_active, task);
+            next_active.finalize();
+            const size_t round_work = total_work.load(std::memory_order_relaxed) + local_work.combine(std::plus<>());
+            work_since_last_global_relabel += round_work;
+            instrumentation.local(PushRelabelPhase::Discharge).scanned(round_work);
+        }
+
+        size_t dischargeHypernode(Node u, tbb::feeder<Node>& feeder) {
+            size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
+            int my_level = level[u];
+            Flow my_excess = loadExcess(u);
+            while (my_excess > 0 && my_level < max_level) {
+                const Flow old_excess = my_excess;
+                int new_level = max_level;
+                for (InHeIndex i : hg.incidentHyperedgeIndices(u)) {
+                    const Hyperedge e = hg.getInHe(i).e;
+                    work++;
+
+                    // push to in-node
+                    const Flow r_in = hg.capacity(e) - loadFlow(inNodeIncidenceIndex(i));
+                    if (r_in > 0) {
+                        const Node e_in = edgeToInNode(e);
+                        const int l = loadLevel(e_in);
+                        if (l < my_level) {
+                            const Flow d = std::min(my_excess, r_in);
+                            __atomic_fetch_add(&flow[inNodeIncidenceIndex(i)], d, __ATOMIC_RELAXED);
+                            my_excess -= d;
+                            push(e_in, d, feeder, counters);
+                        } else {
+                            new_level = std::min(new_level, l);
+                        }
+                    }
+                    if (my_excess == 0)
+                        break;
+
+                    // push back to out-node
+                    const Flow r_out = loadFlow(outNodeIncidenceIndex(i));
+                    if (r_out > 0) {
+                        const Node e_out = edgeToOutNode(e);
+                        const int l = loadLevel(e_out);
+                        if (l < my_level) {
+                            const Flow d = std::min(my_excess, r_out);
+                            __atomic_fetch_sub(&flow[outNodeIncidenceIndex(i)], d, __ATOMIC_RELAXED);
+                            my_excess -= d;
+                            push(e_out, d, feeder, counters);
+                        } else {
+                            new_level = std::min(new_level, l);
+                        }
+                    }
+                    if (my_excess == 0)
+                        break;
+                }
+                my_level = finishScan(u, old_excess, my_excess, my_level, new_level, counters);
+                my_excess = loadExcess(u);
+            }
+            return work;
+        }
+
+        size_t dischargeInNode(Node e_in, tbb::feeder<Node>& feeder) {
+            size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
+            const Hyperedge e = inNodeToEdge(e_in);
+            const Node e_out = edgeToOutNode(e);
+            int my_level = level[e_in];
+            Flow my_excess = loadExcess(e_in);
+            while (my_excess > 0 && my_level < max_level) {
+                const Flow old_excess = my_excess;
+                int new_level = max_level;
+
+                // push through bridge edge
+                const Flow r_bridge = hg.capacity(e) - loadFlow(bridgeEdgeIndex(e));
+                if (r_bridge > 0) {
+                    const int l = loadLevel(e_out);
+                    if (l < my_level) {
+                        const Flow d = std::min(my_excess, r_bridge);
+                        __atomic_fetch_add(&flow[bridgeEdgeIndex(e)], d, __ATOMIC_RELAXED);
+                        my_excess -= d;
+                        push(e_out, d, feeder, counters);
+                    } else {
+                        new_level = std::min(new_level, l);
+                    }
+                }
+                work++;
+
+                // push back to pins
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    if (my_excess == 0) {
+                        break;
+                    }
+                    const Flow r = loadFlow(inNodeIncidenceIndex(pin_ind));
+                    if (r > 0) {
+                        const Node v = hg.getPin(pin_ind).pin;
+                        const int l = loadLevel(v);
+                        if (l < my_level) {
+                            const Flow d = std::min(my_excess, r);
+                            __atomic_fetch_sub(&flow[inNodeIncidenceIndex(pin_ind)], d, __ATOMIC_RELAXED);
+                            my_excess -= d;
+                            push(v, d, feeder, counters);
+                        } else {
+                            new_level = std::min(new_level, l);
+                        }
+                    }
+                    work++;
+                }
+                my_level = finishScan(e_in, old_excess, my_excess, my_level, new_level, counters);
+                my_excess = loadExcess(e_in);
+            }
+            return work;
+        }
+
+        size_t dischargeOutNode(Node e_out, tbb::feeder<Node>& feeder) {
+            size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
+            const Hyperedge e = outNodeToEdge(e_out);
+            const Node e_in = edgeToInNode(e);
+            int my_level = level[e_out];
+            Flow my_excess = loadExcess(e_out);
+            while (my_excess > 0 && my_level < max_level) {
+                const Flow old_excess = my_excess;
+                int new_level = max_level;
+
+                // push out to pins. uncapacitated
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    if (my_excess == 0) {
+                        break;
+                    }
+                    const Node v = hg.getPin(pin_ind).pin;
+                    const int l = loadLevel(v);
+                    if (l < my_level) {
+                        __atomic_fetch_add(&flow[outNodeIncidenceIndex(pin_ind)], my_excess, __ATOMIC_RELAXED);
+                        push(v, my_excess, feeder, counters);
+                        my_excess = 0;
+                    } else {
+                        new_level = std::min(new_level, l);
+                    }
+                    work++;
+                }
+
+                // push back through bridge edge
+                if (my_excess > 0) {
+                    const Flow r_bridge = loadFlow(bridgeEdgeIndex(e));
+                    if (r_bridge > 0) {
+                        const int l = loadLevel(e_in);
+                        if (l < my_level) {
+                            const Flow d = std::min(my_excess, r_bridge);
+                            __atomic_fetch_sub(&flow[bridgeEdgeIndex(e)], d, __ATOMIC_RELAXED);
+                            my_excess -= d;
+                            push(e_in, d, feeder, counters);
+                        } else {
+                            new_level = std::min(new_level, l);
+                        }
+                    }
+                    work++;
+                }
+                my_level = finishScan(e_out, old_excess, my_excess, my_level, new_level, counters);
+                my_excess = loadExcess(e_out);
+            }
+            return work;
+        }
+
+    private:
+        static constexpr size_t work_flush_interval = 4096;
+        std::atomic<bool> park{ false };
+
+        Flow loadExcess(Node u) const { return __atomic_load_n(&excess[u], __ATOMIC_ACQUIRE); }
+        Flow loadFlow(size_t i) const { return __atomic_load_n(&flow[i], __ATOMIC_RELAXED); }
+        int loadLevel(Node u) const { return __atomic_load_n(&level[u], __ATOMIC_RELAXED); }
+
+        // claim and release are sequentially consistent with the excess updates, so that either the pusher claims u or the releasing owner sees the excess
+        bool claim(Node u) {
+            return __atomic_load_n(&last_activated[u], __ATOMIC_SEQ_CST) != round && __atomic_exchange_n(&last_activated[u], round, __ATOMIC_SEQ_CST) != round;
+        }
+        void release(Node u) { __atomic_store_n(&last_activated[u], 0U, __ATOMIC_SEQ_CST); }
+
+        using Counters = PushRelabelInstrumentation::Counters;
+
+        void push(Node v, Flow d, tbb::feeder<Node>& feeder, Counters& counters) {
+            counters.push();
+            touchAtomic(v);
+            __atomic_fetch_add(&excess[v], d, __ATOMIC_SEQ_CST);
+            if (isTarget(v)) {
+                __atomic_fetch_add(&flow_value, d, __ATOMIC_RELAXED);
+            } else if (claim(v)) {
+                feeder.add(v);
+            }
+        }
+
+        // commit the pushes of one scan over the residual edges of u. relabel if excess is left, i.e., all residual edges were scanned
+        int finishScan(Node u, Flow old_excess, Flow my_excess, int my_level, int new_level, Counters& counters) {
+            __atomic_fetch_sub(&excess[u], old_excess - my_excess, __ATOMIC_SEQ_CST);
+            if (my_excess > 0) {
+                counters.relabel();
+                my_level = new_level + 1;
+                __atomic_store_n(&level[u], LevelStorage(my_level), __ATOMIC_RELAXED);
+            }
+            return my_level;
+        }
+    };
+
+    using AsyncPushRelabel = BasicAsyncPushRelabel<>;
+    // 16-bit flow and level storage. only if CompactAsyncPushRelabel::fitsStorage(hg)
+    using CompactAsyncPushRelabel = BasicAsyncPushRelabel<int16_t, int16_t>;
+
+} // namespace whfc
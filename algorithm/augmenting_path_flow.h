@@ -0,0 +1,283 @@
+#pragma once
+
+#include <vector>
+
+#include "../datastructure/flow_hypergraph.h"
+#include "push_relabel_commons.h"
+
+namespace whfc {
+
+    /*
+     * Augmenting path FlowAlgorithm, as used by the original FlowCutter. A round grows a BFS tree from the source piercing nodes
+     * and one from the target piercing nodes in the residual network, always expanding the side with the smaller frontier, and augments
+     * along every edge where the two trees meet. Rounds repeat until one tree runs out of nodes without meeting the other.
+     * After assimilation, all edges leaving the source side and entering the target side are saturated, so the search only starts from the
+     * nodes pierced since the last cut. Hence, an incremental findMinCuts costs about as much as the searches for the paths it finds,
+     * instead of a source saturation plus global relabeling on the whole network. Levels and active nodes are not used, so the level array
+     * is not allocated. That is the only memory saved: the search stamps and the tree arrays still have one entry per node of the network.
+     */
+    template<typename FlowStorage = Flow>
+    class BasicAugmentingPathFlow : public BasicPushRelabelCommons<FlowStorage, int> {
+    public:
+        using Base = BasicPushRelabelCommons<FlowStorage, int>;
+        using Base::hg;
+        using Base::flow;
+        using Base::excess;
+        using Base::reachFromSource;
+        using Base::reachFromTarget;
+        using Base::max_level;
+        using Base::flow_value;
+        using Base::upper_flow_bound;
+        using Base::shall_terminate;
+        using Base::isSource;
+        using Base::isTarget;
+        using Base::isSourceReachable;
+        using Base::isTargetReachable;
+        using Base::resetReachability;
+        using Base::source_piercing_nodes;
+        using Base::target_piercing_nodes;
+        using Base::scanForward;
+        using Base::scanBackward;
+        using Base::forEachResidualEdge;
+        using Base::forEachResidualInEdge;
+        using Base::residualCapacity;
+        using Base::touch;
+        using Base::initialize;
+
+        static constexpr bool log = false;
+
+        explicit BasicAugmentingPathFlow(FlowHypergraph& hg) : Base(hg) { Base::maintain_levels = false; }
+
+        size_t num_augmenting_paths = 0, num_rounds = 0;
+
+        bool findMinCuts() {
+            bool augmented = true;
+            while (augmented) {
+                if (flow_value > upper_flow_bound || shall_terminate) {
+                    return false;
+                }
+                augmented = augmentingRound();
+            }
+            LOGGER << V(flow_value) << V(num_augmenting_paths) << V(num_rounds);
+
+            deriveSourceSideCut(true);
+            deriveTargetSideCut();
+            return true;
+        }
+
+        Flow computeMaxFlow(Node s, Node t) {
+            reset();
+            initialize(s, t);
+            findMinCuts();
+            return flow_value;
+        }
+
+        // returns whether flow was augmented. the round stops after the layer in which the trees first met, since the trees are outdated then
+        bool augmentingRound() {
+            num_rounds++;
+            nextSearch();
+            source_queue.clear();
+            target_queue.clear();
+            for (const Node s : source_piercing_nodes) {
+                visit(s, source_search_stamp, source_queue, invalidNode, 0, false);
+            }
+            // excess nodes from an imported flow act as additional sources
+            size_t j = 0;
+            for (const Node u : excess_nodes) {
+                if (excess[u] > 0 && !isSource(u) && !isTarget(u)) {
+                    excess_nodes[j++] = u;
+                    visit(u, source_search_stamp, source_queue, invalidNode, 0, false);
+                }
+            }
+            excess_nodes.resize(j);
+            for (const Node t : target_piercing_nodes) {
+                visit(t, target_search_stamp, target_queue, invalidNode, 0, false);
+            }
+
+            bool augmented = false;
+            size_t source_first = 0, target_first = 0;
+            while (!augmented && source_first < source_queue.size() && target_first < target_queue.size()) {
+                if (source_queue.size() - source_first <= target_queue.size() - target_first) {
+                    for (const size_t last = source_queue.size(); source_first < last; ++source_first) {
+                        const Node u = source_queue[source_first];
+                        forEachResidualEdge(u, [&](const Node v, Flow, const size_t flow_index, const bool forward) {
+                            if (search[v] == target_search_stamp || isTarget(v)) {
+                                augmented |= augment(u, v, flow_index, forward);
+                            } else if (search[v] != source_search_stamp && !isSource(v)) {
+                                visit(v, source_search_stamp, source_queue, u, flow_index, forward);
+                            }
+                            return true;
+                        });
+                    }
+                } else {
+                    for (const size_t last = target_queue.size(); target_first < last; ++target_first) {
+                        const Node u = target_queue[target_first];
+                        forEachResidualInEdge(u, [&](const Node v, Flow, const size_t flow_index, const bool forward) {
+                            if (search[v] == source_search_stamp || isSource(v)) {
+                                augmented |= augment(v, u, flow_index, forward);
+                            } else if (search[v] != target_search_stamp && !isTarget(v)) {
+                                visit(v, target_search_stamp, target_queue, u, flow_index, forward);
+                            }
+                            return true;
+                        });
+                    }
+                }
+            }
+            return augmented;
+        }
+
+        void deriveSourceSideCut(bool flow_changed) {
+            source_reachable_nodes.clear();
+            if (flow_changed) {
+                resetReachability(true); // if flow didn't change, we can reuse the old stamp
+                for (const Node u : excess_nodes) { // excess that cannot reach the target
+                    if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
+                        source_reachable_nodes.push_back(u);
+                        reachFromSource(u);
+                    }
+                }
+            }
+            for (const Node s : source_piercing_nodes) {
+                source_reachable_nodes.push_back(s);
+            }
+            for (size_t first = 0; first < source_reachable_nodes.size(); ++first) {
+                scanForward(source_reachable_nodes[first], [&](const Node v) {
+                    assert(!isTarget(v));
+                    if (!isSourceReachable(v)) {
+                        reachFromSource(v);
+                        source_reachable_nodes.push_back(v);
+                    }
+                });
+            }
+        }
+
+        void deriveTargetSideCut() {
+            target_reachable_nodes.clear();
+            resetReachability(false);
+            for (const Node t : target_piercing_nodes) {
+                target_reachable_nodes.push_back(t);
+            }
+            for (size_t first = 0; first < target_reachable_nodes.size(); ++first) {
+                scanBackward(target_reachable_nodes[first], [&](const Node v) {
+                    assert(!isSourceReachable(v));
+                    if (!isTargetReachable(v)) {
+                        reachFromTarget(v);
+                        target_reachable_nodes.push_back(v);
+                    }
+                });
+            }
+        }
+
+        const vec<Node>& sourceReachableNodes() const { return source_reachable_nodes; }
+        const vec<Node>& targetReachableNodes() const { return target_reachable_nodes; }
+
+        void reset() {
+            Base::reset();
+            if (source_search_stamp > std::numeric_limits<uint32_t>::max() - 2) {
+                search.assign(max_level, 0);
+                source_search_stamp = 0;
+                target_search_stamp = 0;
+            } else {
+                search.resize(max_level, 0);
+            }
+            tree_parent.resize(max_level);
+            assert(2 * hg.numPins() + hg.numHyperedges() <= std::numeric_limits<uint32_t>::max()); // flow indices fit into tree_flow_index
+            tree_flow_index.resize(max_level);
+            tree_forward.resize(max_level);
+            source_queue.clear();
+            target_queue.clear();
+            excess_nodes.clear();
+            source_reachable_nodes.clear();
+            target_reachable_nodes.clear();
+            num_augmenting_paths = 0;
+            num_rounds = 0;
+        }
+
+        void importFlow(const FlowAssignment& fa, const std::vector<Node>& node_mapping, const std::vector<Hyperedge>& hyperedge_mapping) {
+            Base::importFlow(fa, node_mapping, hyperedge_mapping);
+            excess_nodes.clear();
+            for (int i = 0; i < max_level; ++i) {
+                const Node u(i);
+                if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
+                    excess_nodes.push_back(u);
+                }
+            }
+        }
+
+    private:
+        /** search trees */
+        // a node is in the source tree if search[u] == source_search_stamp, and in the target tree if search[u] == target_search_stamp.
+        // tree_parent is the predecessor towards the root of its tree, and the tree edge is (tree_parent, u) in the source tree
+        // and (u, tree_parent) in the target tree. roots have tree_parent = invalidNode
+        vec<uint32_t> search;
+        uint32_t source_search_stamp = 0, target_search_stamp = 0;
+        vec<Node> tree_parent;
+        vec<uint32_t> tree_flow_index;
+        vec<bool> tree_forward;
+        vec<Node> source_queue, target_queue;
+
+        void nextSearch() {
+            if (target_search_stamp > std::numeric_limits<uint32_t>::max() - 2) {
+                std::fill(search.begin(), search.end(), 0);
+                target_search_stamp = 0;
+            }
+            source_search_stamp = target_search_stamp + 1;
+            target_search_stamp = source_search_stamp + 1;
+        }
+
+        void visit(Node u, uint32_t stamp, vec<Node>& queue, Node parent, size_t flow_index, bool forward) {
+            search[u] = stamp;
+            tree_parent[u] = parent;
+            tree_flow_index[u] = uint32_t(flow_index);
+            tree_forward[u] = forward;
+            queue.push_back(u);
+        }
+
+        // terminals that were not reached in this round are roots as well
+        Node treeParent(Node u) const { return isSource(u) || isTarget(u) ? invalidNode : tree_parent[u]; }
+
+        // augments along the source tree path to u, the edge (u,v) and the target tree path from v. returns whether flow was augmented
+        bool augment(Node u, Node v, size_t flow_index, bool forward) {
+            Flow d = residualCapacity(u, v, flow_index, forward);
+            Node s = u;
+            for (Node p = treeParent(s); p != invalidNode; s = p, p = treeParent(s)) {
+                d = std::min(d, residualCapacity(p, s, tree_flow_index[s], tree_forward[s]));
+            }
+            if (!isSource(s)) {
+                d = std::min(d, excess[s]);
+            }
+            Node t = v;
+            for (Node p = treeParent(t); p != invalidNode; t = p, p = treeParent(t)) {
+                d = std::min(d, residualCapacity(t, p, tree_flow_index[t], tree_forward[t]));
+            }
+            if (d <= 0) { // an earlier path of this round saturated an edge
+                return false;
+            }
+
+            auto push = [&](size_t flow_index, bool forward) { flow[flow_index] += forward ? d : -d; };
+            push(flow_index, forward);
+            touch(u);
+            for (Node x = u; treeParent(x) != invalidNode; x = treeParent(x)) {
+                push(tree_flow_index[x], tree_forward[x]);
+                touch(treeParent(x));
+            }
+            touch(v);
+            for (Node x = v; treeParent(x) != invalidNode; x = treeParent(x)) {
+                push(tree_flow_index[x], tree_forward[x]);
+                touch(treeParent(x));
+            }
+            excess[s] -= d;
+            excess[t] += d;
+            flow_value += d;
+            num_augmenting_paths++;
+            return true;
+        }
+
+        /** all nodes with excess from an imported flow. may contain nodes whose excess was routed */
+        vec<Node> excess_nodes;
+        vec<Node> source_reachable_nodes, target_reachable_nodes;
+    };
+
+    using AugmentingPathFlow = BasicAugmentingPathFlow<>;
+
+} // namespace whfc
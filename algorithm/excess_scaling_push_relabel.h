@@ -0,0 +1,229 @@
+#pragma once
+
+#include "sequential_push_relabel.h"
+
+namespace whfc {
+
+    /*
+     * Excess scaling push-relabel (Ahuja and Orlin) on the Lawler network. In the phase with scaling parameter delta, only nodes with
+     * excess > delta / 2 are selected, the one with the lowest level first, and no push lets a non-target node exceed delta.
+     * So the flow is moved in large chunks first, which saves relabel work on instances with very skewed hyperedge capacities.
+     * Source saturation, global relabeling and the cut derivation are shared with SequentialPushRelabel.
+     */
+    template<typename FlowStorage = Flow, typename LevelStorage = int>
+    class BasicExcessScalingPushRelabel : public BasicSequentialPushRelabel<FlowStorage, LevelStorage> {
+    public:
+        using Base = BasicSequentialPushRelabel<FlowStorage, LevelStorage>;
+        using Base::hg;
+        using Base::flow;
+        using Base::excess;
+        using Base::level;
+        using Base::max_level;
+        using Base::flow_value;
+        using Base::upper_flow_bound;
+        using Base::shall_terminate;
+        using Base::isHypernode;
+        using Base::isOutNode;
+        using Base::inNodeToEdge;
+        using Base::outNodeToEdge;
+        using Base::edgeToInNode;
+        using Base::edgeToOutNode;
+        using Base::inNodeIncidenceIndex;
+        using Base::outNodeIncidenceIndex;
+        using Base::bridgeEdgeIndex;
+        using Base::isSource;
+        using Base::isTarget;
+        using Base::work_since_last_global_relabel;
+        using Base::global_relabel_work_threshold;
+        using Base::touch;
+        using Base::initialize;
+        using Base::saturateSourceEdges;
+        using Base::globalRelabel;
+        using Base::deriveSourceSideCut;
+        using Base::deriveTargetSideCut;
+        using Base::forEachResidualEdge;
+
+        static constexpr bool log = false;
+
+        explicit BasicExcessScalingPushRelabel(FlowHypergraph& hg) : Base(hg) {}
+
+        bool findMinCuts() {
+            saturateSourceEdges();
+            globalRelabel();
+
+            // collect the excess nodes and choose the first scaling parameter
+            for (const Node u : excess_nodes) {
+                listed[u] = false;
+            }
+            excess_nodes.clear();
+            int64_t max_excess = 0;
+            for (int i = 0; i < max_level; ++i) {
+                const Node u(i);
+                if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
+                    listExcessNode(u);
+                    if (level[u] < max_level) {
+                        max_excess = std::max<int64_t>(max_excess, excess[u]);
+                    }
+                }
+            }
+            delta = 1;
+            while (delta < max_excess) {
+                delta *= 2;
+            }
+
+            for (; delta >= 1; delta /= 2) {
+                num_scaling_phases++;
+                fillLargeExcessBuckets();
+                while (num_large_excess_nodes > 0) {
+                    if (flow_value > upper_flow_bound || shall_terminate) {
+                        return false;
+                    }
+                    if (work_since_last_global_relabel > global_relabel_work_threshold) {
+                        globalRelabel();
+                        fillLargeExcessBuckets(); // levels changed
+                        continue;
+                    }
+                    const Node u = popLowestLargeExcessNode();
+                    if (hasLargeExcess(u) && level[u] < max_level) {
+                        work_since_last_global_relabel += processLargeExcessNode(u);
+                    }
+                }
+            }
+            LOGGER << V(flow_value);
+
+            deriveSourceSideCut(true);
+            deriveTargetSideCut();
+            return true;
+        }
+
+        Flow computeMaxFlow(Node s, Node t) {
+            reset();
+            initialize(s, t);
+            findMinCuts();
+            return flow_value;
+        }
+
+        // pushes along admissible edges, such that no non-target node exceeds delta. relabels if no admissible edge is left.
+        // stops early if a node on a lower level gets large excess, since that one is next
+        size_t processLargeExcessNode(Node u) {
+            size_t work = 0;
+            const int my_level = level[u];
+            int new_level = max_level - 1;
+            bool relabel = true;
+            forEachResidualEdge(u, [&](const Node v, const Flow residual, const size_t flow_index, const bool forward) {
+                work++;
+                if (my_level == level[v] + 1) {
+                    const int64_t room = isTarget(v) ? excess[u] : delta - excess[v];
+                    const Flow d = Flow(std::min<int64_t>({ excess[u], residual, room }));
+                    if (d > 0) {
+                        flow[flow_index] += forward ? d : -d;
+                        excess[u] -= d;
+                        if (isTarget(v)) {
+                            flow_value += d;
+                        } else if (excess[v] == 0) {
+                            listExcessNode(v);
+                        }
+                        touch(v);
+                        excess[v] += d;
+                        if (!isTarget(v) && hasLargeExcess(v)) {
+                            pushLargeExcessNode(v);
+                        }
+                    }
+                    if (excess[u] == 0 || d < residual) { // done, or v is full
+                        relabel = false;
+                        return false;
+                    }
+                } else if (my_level <= level[v]) {
+                    new_level = std::min<int>(new_level, level[v]);
+                }
+                return true;
+            });
+
+            if (relabel) {
+                level[u] = new_level + 1;
+            }
+            if (hasLargeExcess(u) && level[u] < max_level) {
+                pushLargeExcessNode(u);
+            }
+            return work;
+        }
+
+        size_t num_scaling_phases = 0;
+
+        void reset() {
+            Base::reset();
+            num_scaling_phases = 0;
+            listed.assign(max_level, false);
+            large_excess_first.assign(max_level + 1, invalidNode);
+            large_excess_next.resize(max_level);
+            queued.assign(max_level, false);
+            num_large_excess_nodes = 0;
+            lowest_large_excess_level = max_level;
+            excess_nodes.clear();
+        }
+
+    private:
+        int64_t delta = 1;
+
+        /** all nodes that got excess. may contain nodes whose excess was pushed on */
+        vec<Node> excess_nodes;
+        vec<bool> listed;
+        void listExcessNode(Node u) {
+            if (!listed[u]) {
+                listed[u] = true;
+                excess_nodes.push_back(u);
+            }
+        }
+
+        /** nodes with excess > delta / 2, bucketed by level */
+        vec<Node> large_excess_first, large_excess_next;
+        vec<bool> queued;
+        size_t num_large_excess_nodes = 0;
+        int lowest_large_excess_level = 0;
+
+        bool hasLargeExcess(Node u) const { return 2 * int64_t(excess[u]) > delta; }
+        void pushLargeExcessNode(Node u) {
+            if (!queued[u]) {
+                queued[u] = true;
+                large_excess_next[u] = large_excess_first[level[u]];
+                large_excess_first[level[u]] = u;
+                lowest_large_excess_level = std::min<int>(lowest_large_excess_level, level[u]);
+                num_large_excess_nodes++;
+            }
+        }
+        Node popLowestLargeExcessNode() {
+            assert(num_large_excess_nodes > 0);
+            while (large_excess_first[lowest_large_excess_level] == invalidNode) {
+                lowest_large_excess_level++;
+            }
+            const Node u = large_excess_first[lowest_large_excess_level];
+            large_excess_first[lowest_large_excess_level] = large_excess_next[u];
+            queued[u] = false;
+            num_large_excess_nodes--;
+            return u;
+        }
+
+        // drops nodes without excess from excess_nodes and buckets the large ones
+        void fillLargeExcessBuckets() {
+            while (num_large_excess_nodes > 0) {
+                popLowestLargeExcessNode();
+            }
+            lowest_large_excess_level = max_level;
+            size_t j = 0;
+            for (const Node u : excess_nodes) {
+                if (excess[u] > 0 && !isTarget(u) && !isSource(u)) {
+                    excess_nodes[j++] = u;
+                    if (hasLargeExcess(u) && level[u] < max_level) {
+                        pushLargeExcessNode(u);
+                    }
+                } else {
+                    listed[u] = false;
+                }
+            }
+            excess_nodes.resize(j);
+        }
+    };
+
+    using ExcessScalingPushRelabel = BasicExcessScalingPushRelabel<>;
+
+} // namespace whfc
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <tbb/task_arena.h>
 #include <tbb/tick_count.h>
+#include "../datastructure/flow_assignment.h"
 #include "../datastructure/flow_hypergraph.h"
 #include "cutter_state.h"
 #include "piercing.h"
@@ -21,6 +23,7 @@ namespace whfc {
 
         HyperFlowCutter(FlowHypergraph& hg, int seed, bool deterministic = false) : timer("HyperFlowCutter"), hg(hg), cs(hg, timer), piercer(hg, cs) {
             piercer.deterministic = deterministic;
+            cs.flow_algo.deterministic = deterministic;
             cs.rng.setSeed(seed);
             reset();
         }
@@ -71,27 +74,34 @@ namespace whfc {
 
         /*
          * Equivalent to runUntilBalancedOrFlowBoundExceeded(s,t) except that it does not use the flow-based interleaving that is necessary when running
-         * multiple HFC instances
+         * multiple HFC instances. For that, see InterleavedHyperFlowCutters, which drives instances through startCutEnumeration, findNextCut
+         * and finishCutEnumeration.
          */
         template<typename CutReporter>
         bool enumerateCutsUntilBalancedOrFlowBoundExceeded(const Node s, const Node t, CutReporter&& on_cut) {
-            cs.initialize(s, t);
-            piercer.initialize();
-            bool has_balanced_cut_below_flow_bound = false;
-            while (!has_balanced_cut_below_flow_bound && findNextCut() && on_cut()) {
-                has_balanced_cut_below_flow_bound |= cs.isBalanced();
+            if (arena) {
+                return arena->execute([&] { return enumerateCuts(s, t, on_cut); });
             }
+            return enumerateCuts(s, t, on_cut);
+        }
 
-            if (has_balanced_cut_below_flow_bound) {
-                if (find_most_balanced && !cs.addingAllUnreachableNodesDoesNotChangeHeavierBlock()) {
-                    mostBalancedCut();
-                } else {
-                    cs.writePartition();
-                }
-                LOGGER << cs.toString();
+        void startCutEnumeration(const Node s, const Node t) {
+            cs.initialize(s, t);
+            if (warm_start.flow) {
+                cs.flow_algo.importFlow(*warm_start.flow, *warm_start.node_mapping, *warm_start.hyperedge_mapping);
+                warm_start = WarmStart();
             }
+            piercer.initialize();
+        }
 
-            return has_balanced_cut_below_flow_bound;
+        // call once the current cut is balanced. writes the partition, improved to the most balanced cut if enabled
+        void finishCutEnumeration() {
+            if (find_most_balanced && !cs.addingAllUnreachableNodesDoesNotChangeHeavierBlock()) {
+                mostBalancedCut();
+            } else {
+                cs.writePartition();
+            }
+            LOGGER << cs.toString();
         }
 
         bool enumerateCutsUntilBalancedOrFlowBoundExceeded(const Node s, const Node t) {
@@ -164,6 +174,46 @@ namespace whfc {
         void forceSequential(bool force) { cs.force_sequential = force; }
 
         void setSeed(int seed) { cs.rng.setSeed(seed); }
+
+        // runs enumerateCutsUntilBalancedOrFlowBoundExceeded and the flow algorithm inside the given arena, e.g., a PinnedArena,
+        // instead of the arena of the calling thread. nullptr to reset
+        void setArena(tbb::task_arena* a) { arena = a; }
+
+        void setParallelTargetSideCut(bool parallel) { cs.flow_algo.parallel_target_side_cut = parallel; }
+
+        // export the flow of the current run, e.g., before rebuilding hg for the next, overlapping flow problem
+        void exportFlow(FlowAssignment& fa) const { cs.flow_algo.exportFlow(fa); }
+
+        // the next run starts from the given flow instead of zero. mappings go from IDs of the exported run to IDs in hg.
+        // the referenced data must stay alive until the next call to enumerateCutsUntilBalancedOrFlowBoundExceeded
+        void setWarmStart(const FlowAssignment& fa, const std::vector<Node>& node_mapping, const std::vector<Hyperedge>& hyperedge_mapping) {
+            warm_start = { &fa, &node_mapping, &hyperedge_mapping };
+        }
+
+    private:
+        tbb::task_arena* arena = nullptr;
+
+        template<typename CutReporter>
+        bool enumerateCuts(const Node s, const Node t, CutReporter&& on_cut) {
+            startCutEnumeration(s, t);
+            bool has_balanced_cut_below_flow_bound = false;
+            while (!has_balanced_cut_below_flow_bound && findNextCut() && on_cut()) {
+                has_balanced_cut_below_flow_bound |= cs.isBalanced();
+            }
+
+            if (has_balanced_cut_below_flow_bound) {
+                finishCutEnumeration();
+            }
+
+            return has_balanced_cut_below_flow_bound;
+        }
+
+        struct WarmStart {
+            const FlowAssignment* flow = nullptr;
+            const std::vector<Node>* node_mapping = nullptr;
+            const std::vector<Hyperedge>* hyperedge_mapping = nullptr;
+        };
+        WarmStart warm_start;
     };
 
 } // namespace whfc
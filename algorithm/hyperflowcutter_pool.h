@@ -0,0 +1,155 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../datastructure/flow_hypergraph_builder.h"
+#include "hyperflowcutter.h"
+
+namespace whfc {
+
+    /*
+     * Thread-safe pool of HyperFlowCutter instances, each bound to its own FlowHypergraphBuilder. Returned instances keep their buffers,
+     * so that refinement jobs on many block pairs and rounds do not allocate once the pool is warm. New instances preallocate their
+     * builder via FlowHypergraphBuilder(maxNumNodes, maxNumHyperedges, maxNumPins) for the largest hypergraph returned to the pool so far,
+     * and their flow algorithm and cutter state for the same size.
+     *
+     * A job acquires a lease, builds its hypergraph with lease.hypergraph() (clear / reinitialize, ..., finalize), calls lease.cutter().reset()
+     * and then runs the cutter as usual. Settings such as setBulkPiercing or the max block weights persist across leases.
+     */
+    template<class FlowAlgorithm>
+    class HyperFlowCutterPool {
+    public:
+        struct Capacity {
+            size_t nodes = 0, hyperedges = 0, pins = 0;
+        };
+
+        struct Statistics {
+            size_t instances_created = 0;
+            size_t idle_instances = 0;
+            size_t in_use = 0;
+            size_t max_in_use = 0; // high-water mark of simultaneously leased instances
+            size_t acquisitions = 0;
+            Capacity largest_hypergraph; // high-water mark of the hypergraphs built in leased instances
+        };
+
+    private:
+        struct Instance {
+            FlowHypergraphBuilder hgb;
+            HyperFlowCutter<FlowAlgorithm> hfc;
+
+            Instance(const Capacity& c, int seed, bool deterministic) : hgb(c.nodes, c.hyperedges, c.pins), hfc(hgb, seed, deterministic) {}
+        };
+
+    public:
+        // returns the instance to the pool on destruction
+        class Lease {
+        public:
+            Lease(Lease&& o) noexcept : pool(o.pool), instance(std::move(o.instance)) { o.pool = nullptr; }
+            Lease& operator=(Lease&& o) noexcept {
+                release();
+                pool = o.pool;
+                instance = std::move(o.instance);
+                o.pool = nullptr;
+                return *this;
+            }
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+            ~Lease() { release(); }
+
+            FlowHypergraphBuilder& hypergraph() { return instance->hgb; }
+            HyperFlowCutter<FlowAlgorithm>& cutter() { return instance->hfc; }
+
+            // returns the instance early. the lease must not be used afterwards
+            void release() {
+                if (pool) {
+                    pool->giveBack(std::move(instance));
+                    pool = nullptr;
+                }
+            }
+
+        private:
+            friend class HyperFlowCutterPool;
+            Lease(HyperFlowCutterPool* pool, std::unique_ptr<Instance> instance) : pool(pool), instance(std::move(instance)) {}
+
+            HyperFlowCutterPool* pool;
+            std::unique_ptr<Instance> instance;
+        };
+
+        explicit HyperFlowCutterPool(bool deterministic = false) : deterministic(deterministic) {}
+
+        // outstanding leases must be released before the pool is destroyed
+        ~HyperFlowCutterPool() { assert(stats.in_use == 0); }
+
+        HyperFlowCutterPool(const HyperFlowCutterPool&) = delete;
+        HyperFlowCutterPool& operator=(const HyperFlowCutterPool&) = delete;
+
+        Lease acquire(int seed) {
+            std::unique_ptr<Instance> instance;
+            Capacity capacity;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.acquisitions++;
+                stats.in_use++;
+                stats.max_in_use = std::max(stats.max_in_use, stats.in_use);
+                if (!idle.empty()) {
+                    instance = std::move(idle.back());
+                    idle.pop_back();
+                } else {
+                    stats.instances_created++;
+                    capacity = stats.largest_hypergraph;
+                }
+            }
+            if (instance) {
+                instance->hfc.setSeed(seed);
+            } else {
+                instance = std::make_unique<Instance>(capacity, seed, deterministic); // allocate outside the lock
+            }
+            return Lease(this, std::move(instance));
+        }
+
+        // lets new instances preallocate for hypergraphs of this size, e.g., the largest expected snapshot
+        void reserveCapacity(size_t nodes, size_t hyperedges, size_t pins) {
+            std::lock_guard<std::mutex> lock(mutex);
+            updateCapacity(stats.largest_hypergraph, { nodes, hyperedges, pins });
+        }
+
+        // frees the idle instances and forgets the largest hypergraph, e.g., between partitioning runs
+        void releaseIdleInstances() {
+            std::vector<std::unique_ptr<Instance>> freed;
+            std::lock_guard<std::mutex> lock(mutex);
+            freed.swap(idle);
+            stats.largest_hypergraph = Capacity();
+        }
+
+        Statistics statistics() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            Statistics res = stats;
+            res.idle_instances = idle.size();
+            return res;
+        }
+
+    private:
+        static void updateCapacity(Capacity& c, const Capacity& o) {
+            c.nodes = std::max(c.nodes, o.nodes);
+            c.hyperedges = std::max(c.hyperedges, o.hyperedges);
+            c.pins = std::max(c.pins, o.pins);
+        }
+
+        void giveBack(std::unique_ptr<Instance> instance) {
+            const FlowHypergraphBuilder& hgb = instance->hgb;
+            const Capacity used{ hgb.numNodes(), hgb.numHyperedges(), hgb.numPins() };
+            std::lock_guard<std::mutex> lock(mutex);
+            updateCapacity(stats.largest_hypergraph, used);
+            stats.in_use--;
+            idle.push_back(std::move(instance));
+        }
+
+        bool deterministic;
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<Instance>> idle;
+        Statistics stats;
+    };
+
+} // namespace whfc
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
+#include <vector>
+
+#include "hyperflowcutter.h"
+
+namespace whfc {
+
+    /*
+     * Runs several HyperFlowCutter instances with different seeds and/or terminals on the same hypergraph and returns the balanced cut with
+     * the smallest flow among them. The instances advance in rounds: in each round, every running instance computes its next cut, in parallel.
+     * After each round the best flow bound is shared: once an instance found a balanced cut with flow F, instances at flow >= F stop,
+     * and the others continue with flow bound F - 1, which also stops them as soon as their flow reaches F.
+     * Trades cores for better cuts at roughly the wall-clock time of a single run. The hypergraph is only read, so all instances share it.
+     */
+    template<class FlowAlgorithm>
+    class InterleavedHyperFlowCutters {
+    public:
+        using Cutter = HyperFlowCutter<FlowAlgorithm>;
+
+        static constexpr bool log = false;
+
+        // of the last run
+        struct Statistics {
+            size_t rounds = 0;
+            size_t steps = 0; // calls of findNextCut
+            size_t max_steps_per_round = 0;
+            size_t cut_off = 0; // instances stopped by the flow bound of another instance
+        };
+        Statistics stats;
+
+        // instance i uses seed + i
+        InterleavedHyperFlowCutters(FlowHypergraph& hg, size_t num_instances, int seed, bool deterministic = false) {
+            assert(num_instances > 0);
+            for (size_t i = 0; i < num_instances; ++i) {
+                instances.push_back(std::make_unique<Cutter>(hg, seed + int(i), deterministic));
+            }
+        }
+
+        size_t numInstances() const { return instances.size(); }
+
+        Cutter& instance(size_t i) { return *instances[i]; }
+
+        // the instance holding the result of the last successful run
+        Cutter& bestInstance() {
+            assert(best != invalidIndex);
+            return *instances[best];
+        }
+
+        void reset() {
+            for (auto& hfc : instances)
+                hfc->reset();
+            best = invalidIndex;
+            terminate = false;
+        }
+
+        void setMaxBlockWeight(int side, NodeWeight w) {
+            for (auto& hfc : instances)
+                hfc->cs.setMaxBlockWeight(side, w);
+        }
+
+        void setFlowBound(Flow bound) {
+            for (auto& hfc : instances)
+                hfc->setFlowBound(bound);
+        }
+
+        // can be called from another thread to abort the run
+        void signalTermination() {
+            terminate = true;
+            for (auto& hfc : instances)
+                hfc->signalTermination();
+        }
+
+        bool runUntilBalancedOrFlowBoundExceeded(const Node s, const Node t) { return runUntilBalancedOrFlowBoundExceeded({ { s, t } }); }
+
+        // instance i starts from terminals[i % terminals.size()]. returns whether a balanced cut below the flow bound was found.
+        // the partition is written to bestInstance()
+        bool runUntilBalancedOrFlowBoundExceeded(const std::vector<std::pair<Node, Node>>& terminals) {
+            assert(!terminals.empty());
+            const size_t n = instances.size();
+            best = invalidIndex;
+            stats = Statistics();
+            std::vector<Status> status(n, Status::Running);
+            std::vector<uint8_t> has_next_cut(n, false);
+            std::vector<size_t> running;
+            tbb::task_group tg;
+
+            for (size_t i = 0; i < n; ++i) {
+                const auto [s, t] = terminals[i % terminals.size()];
+                tg.run([&, i, s = s, t = t] { instances[i]->startCutEnumeration(s, t); });
+            }
+            tg.wait();
+
+            Flow best_flow = std::numeric_limits<Flow>::max();
+            size_t num_running = n;
+            while (num_running > 0 && !terminate) {
+                // the running instances are below the shared bound
+                running.clear();
+                for (size_t i = 0; i < n; ++i) {
+                    if (status[i] == Status::Running) {
+                        running.push_back(i);
+                    }
+                }
+                auto step = [&](size_t j) { has_next_cut[running[j]] = instances[running[j]]->findNextCut(); };
+                tbb::parallel_for(size_t(0), running.size(), step, tbb::simple_partitioner()); // one instance per task
+                stats.rounds++;
+                stats.steps += running.size();
+                stats.max_steps_per_round = std::max(stats.max_steps_per_round, running.size());
+
+                // in index order, so that ties are broken deterministically
+                for (const size_t i : running) {
+                    if (!has_next_cut[i]) {
+                        status[i] = Status::Stopped;
+                    } else if (instances[i]->cs.isBalanced()) {
+                        status[i] = Status::Stopped;
+                        const Flow f = flowValue(i);
+                        if (f < best_flow) {
+                            best_flow = f;
+                            best = i;
+                        }
+                    }
+                }
+
+                num_running = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    if (status[i] == Status::Running) {
+                        if (flowValue(i) >= best_flow) {
+                            status[i] = Status::Stopped;
+                            stats.cut_off++;
+                        } else {
+                            if (best_flow != std::numeric_limits<Flow>::max()) {
+                                instances[i]->setFlowBound(std::min(best_flow - 1, instances[i]->cs.flow_algo.upper_flow_bound));
+                            }
+                            num_running++;
+                        }
+                    }
+                }
+                LOGGER << V(num_running) << V(best_flow);
+            }
+
+            if (best != invalidIndex) {
+                instances[best]->finishCutEnumeration();
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        enum class Status : uint8_t { Running, Stopped };
+
+        Flow flowValue(size_t i) const { return instances[i]->cs.flow_algo.flow_value; }
+
+        std::vector<std::unique_ptr<Cutter>> instances;
+        size_t best = invalidIndex;
+        std::atomic<bool> terminate{ false };
+    };
+
+} // namespace whfc
@@ -5,20 +5,77 @@
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_invoke.h>
 #include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
 #include <tbb/tick_count.h>
 
 #include "../util/sub_range.h"
 
-#include "../datastructure/buffered_vector.h"
+#include "../datastructure/chunked_frontier.h"
 
 namespace whfc {
 
-    class ParallelPushRelabel : public PushRelabelCommons {
+    template<typename FlowStorage = Flow, typename LevelStorage = int>
+    class BasicParallelPushRelabel : public BasicPushRelabelCommons<FlowStorage, LevelStorage> {
     public:
+        using Base = BasicPushRelabelCommons<FlowStorage, LevelStorage>;
+        using Base::hg;
+        using Base::flow;
+        using Base::excess;
+        using Base::level;
+        using Base::reachFromSource;
+        using Base::reachFromTarget;
+        using Base::tryReachFromSource;
+        using Base::tryReachFromTarget;
+        using Base::max_level;
+        using Base::flow_value;
+        using Base::upper_flow_bound;
+        using Base::shall_terminate;
+        using Base::deterministic;
+        using Base::global_relabel_time;
+        using Base::update_time;
+        using Base::discharge_time;
+        using Base::saturate_time;
+        using Base::source_cut_time;
+        using Base::sequential_time;
+        using Base::isHypernode;
+        using Base::isOutNode;
+        using Base::inNodeToEdge;
+        using Base::outNodeToEdge;
+        using Base::edgeToInNode;
+        using Base::edgeToOutNode;
+        using Base::inNodeIncidenceIndex;
+        using Base::outNodeIncidenceIndex;
+        using Base::bridgeEdgeIndex;
+        using Base::winEdge;
+        using Base::isSource;
+        using Base::isTarget;
+        using Base::isSourceReachable;
+        using Base::isTargetReachable;
+        using Base::resetReachability;
+        using Base::work_since_last_global_relabel;
+        using Base::global_relabel_work_threshold;
+        using Base::distance_labels_broken_from_target_side_piercing;
+        using Base::source_piercing_nodes;
+        using Base::target_piercing_nodes;
+        using Base::source_piercing_nodes_not_exhausted;
+        using Base::initialize;
+        using Base::scanForward;
+        using Base::scanBackward;
+        using Base::scanLength;
+        using Base::sparse_reset;
+        using Base::isTouched;
+        using Base::touchedEntry;
+        using Base::touched_nodes;
+        using Base::touch;
+        using Base::instrumentation;
+        using Base::numa_aware;
+        using Base::resizeArray;
+        using Base::assignArray;
+
         static constexpr bool log = false;
         static constexpr bool capacitate_incoming_edges_of_in_nodes = true;
 
-        ParallelPushRelabel(FlowHypergraph& hg) : PushRelabelCommons(hg), next_active(0) {}
+        BasicParallelPushRelabel(FlowHypergraph& hg) : Base(hg), next_active(0) {}
 
         bool findMinCuts() {
             if (!augmentFlow()) {
@@ -59,13 +116,19 @@ namespace whfc {
 
                         Flow old_flow_value = flow_value;
 
-                        auto t3 = tbb::tick_count::now();
-                        dischargeActiveNodes();
-                        auto t4 = tbb::tick_count::now();
-                        discharge_time += (t4 - t3).seconds();
-                        applyUpdates();
-                        auto t5 = tbb::tick_count::now();
-                        update_time += (t5 - t4).seconds();
+                        if (num_active < sequential_fallback_threshold) {
+                            auto t3 = tbb::tick_count::now();
+                            dischargeSequentially();
+                            sequential_time += (tbb::tick_count::now() - t3).seconds();
+                        } else {
+                            auto t3 = tbb::tick_count::now();
+                            dischargeActiveNodes();
+                            auto t4 = tbb::tick_count::now();
+                            discharge_time += (t4 - t3).seconds();
+                            applyUpdates();
+                            auto t5 = tbb::tick_count::now();
+                            update_time += (t5 - t4).seconds();
+                        }
 
 
                         if (old_flow_value == flow_value && num_active < 1500 && next_active.size() < 1500) {
@@ -92,6 +155,7 @@ namespace whfc {
         }
 
         void dischargeActiveNodes() {
+            auto phase = instrumentation.scope(PushRelabelPhase::Discharge);
             resetRound();
             tbb::enumerable_thread_specific<size_t> work(0);
             auto task = [&](size_t i) {
@@ -110,10 +174,64 @@ namespace whfc {
             };
             tbb::parallel_for<size_t>(0UL, num_active, task);
             next_active.finalize();
-            work_since_last_global_relabel += work.combine(std::plus<>());
+            const size_t round_work = work.combine(std::plus<>());
+            work_since_last_global_relabel += round_work;
+            instrumentation.local(PushRelabelPhase::Discharge).activeNodes(num_active);
+            instrumentation.local(PushRelabelPhase::Discharge).scanned(round_work);
+        }
+
+        /** sequential fallback */
+        // Rounds with few active nodes are dominated by scheduling, buffer flushing and the two passes of applyUpdates.
+        // Below the threshold, the active nodes are discharged in FIFO order on the same arrays, without excess_diff and next_level.
+        // Once the queue grows beyond sequential_fallback_hysteresis times the threshold, the remaining nodes go back to the parallel rounds.
+        // Time spent in the sequential mode is sequential_time, in the parallel mode discharge_time + update_time. Threshold 0 disables the fallback.
+        size_t sequential_fallback_threshold = 128;
+        size_t sequential_fallback_hysteresis = 4;
+        size_t num_sequential_fallbacks = 0, num_sequential_fallback_exits = 0; // exits due to the queue size
+
+        void dischargeSequentially() {
+            auto phase = instrumentation.scope(PushRelabelPhase::SequentialDischarge);
+            auto& counters = instrumentation.local(PushRelabelPhase::SequentialDischarge);
+            resetRound(); // nodes in the queue are marked as active in this round
+            num_sequential_fallbacks++;
+            sequential_queue.clear();
+            for (size_t i = 0; i < num_active; ++i) {
+                if (activate(active[i])) {
+                    sequential_queue.push(active[i]);
+                }
+            }
+
+            const size_t max_queue_size = sequential_fallback_threshold * sequential_fallback_hysteresis;
+            while (!sequential_queue.empty() && sequential_queue.size() <= max_queue_size) {
+                if (flow_value > upper_flow_bound || shall_terminate || work_since_last_global_relabel > global_relabel_work_threshold) {
+                    break;
+                }
+                const Node u = sequential_queue.pop();
+                last_activated[u] = 0;
+                if (excess[u] == 0 || level[u] >= max_level || isTarget(u)) {
+                    continue;
+                }
+                const size_t work_before = work_since_last_global_relabel;
+                if (isHypernode(u)) {
+                    work_since_last_global_relabel += dischargeHypernode<true>(u);
+                } else if (isOutNode(u)) {
+                    work_since_last_global_relabel += dischargeOutNode<true>(u);
+                } else {
+                    work_since_last_global_relabel += dischargeInNode<true>(u);
+                }
+                counters.activeNodes(1);
+                counters.scanned(work_since_last_global_relabel - work_before);
+            }
+
+            // hand the rest over to the main loop. they keep their marker, so that global relabeling does not insert them twice
+            num_sequential_fallback_exits += sequential_queue.size() > max_queue_size;
+            while (!sequential_queue.empty()) {
+                next_active.push_back_atomic(sequential_queue.pop());
+            }
         }
 
         void applyUpdates() {
+            auto phase = instrumentation.scope(PushRelabelPhase::ApplyUpdates);
             tbb::parallel_for<size_t>(0UL, num_active, [&](size_t i) {
                 const Node u = active[i];
                 if (level[u] >= max_level) {
@@ -129,19 +247,37 @@ namespace whfc {
             });
             tbb::parallel_for<size_t>(0UL, next_active.size(), [&](size_t i) {
                 const Node u = next_active[i];
+                if (sparse_reset && !isTouched(u)) {
+                    touched_nodes.push_back_buffered(touchedEntry(u));
+                }
                 excess[u] += excess_diff[u];
                 if (isTarget(u) && excess_diff[u] > 0) {
                     __atomic_fetch_add(&flow_value, excess_diff[u], __ATOMIC_RELAXED);
                 }
                 excess_diff[u] = 0;
             });
+            touched_nodes.finalize();
         }
 
+        template<bool sequential = false>
         size_t dischargeHypernode(Node u) {
             auto next_active_handle = next_active.local_buffer();
-            auto push = [&](Node v) {
-                if (activate(v))
-                    next_active_handle.push_back(v);
+            auto& counters = instrumentation.local(sequential ? PushRelabelPhase::SequentialDischarge : PushRelabelPhase::Discharge);
+            auto push = [&](Node v, Flow d) {
+                counters.push();
+                if constexpr (sequential) {
+                    touch(v);
+                    excess[v] += d;
+                    if (isTarget(v)) {
+                        flow_value += d;
+                    } else if (activate(v)) {
+                        sequential_queue.push(v);
+                    }
+                } else {
+                    __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
+                    if (activate(v))
+                        next_active_handle.push_back(v);
+                }
             };
             size_t work = 0;
             Flow my_excess = excess[u];
@@ -161,16 +297,15 @@ namespace whfc {
                         d = std::min(d, hg.capacity(e) - flow[inNodeIncidenceIndex(i)]);
                     }
                     if (my_level == level[e_in] + 1) {
-                        if (excess[e_in] > 0 && !winEdge(u, e_in)) {
+                        if (!sequential && excess[e_in] > 0 && !winEdge(u, e_in)) {
                             skipped = true;
                         } else if (d > 0) {
                             flow[inNodeIncidenceIndex(i)] += d;
                             my_excess -= d;
-                            __atomic_fetch_add(&excess_diff[e_in], d, __ATOMIC_RELAXED);
-                            push(e_in);
+                            push(e_in, d);
                         }
                     } else if (my_level <= level[e_in] && d > 0) {
-                        new_level = std::min(new_level, level[e_in]);
+                        new_level = std::min<int>(new_level, level[e_in]);
                     }
                 }
                 work += i - hg.beginIndexHyperedges(u);
@@ -182,20 +317,19 @@ namespace whfc {
                     Hyperedge e = hg.getInHe(i).e;
                     Node e_out = edgeToOutNode(e);
                     if (my_level == level[e_out] + 1) {
-                        if (excess[e_out] > 0 && !winEdge(u, e_out)) {
+                        if (!sequential && excess[e_out] > 0 && !winEdge(u, e_out)) {
                             skipped = true;
                         } else {
-                            const Flow d = std::min(my_excess, flow[outNodeIncidenceIndex(i)]);
+                            const Flow d = std::min<Flow>(my_excess, flow[outNodeIncidenceIndex(i)]);
                             if (d > 0) {
                                 assert(flow[outNodeIncidenceIndex(i)] <= hg.capacity(e));
                                 flow[outNodeIncidenceIndex(i)] -= d;
                                 my_excess -= d;
-                                __atomic_fetch_add(&excess_diff[e_out], d, __ATOMIC_RELAXED);
-                                push(e_out);
+                                push(e_out, d);
                             }
                         }
                     } else if (my_level <= level[e_out] && flow[outNodeIncidenceIndex(i)] > 0) {
-                        new_level = std::min(new_level, level[e_out]);
+                        new_level = std::min<int>(new_level, level[e_out]);
                     }
                 }
                 work += i - hg.beginIndexHyperedges(u);
@@ -203,23 +337,43 @@ namespace whfc {
                 if (my_excess == 0 || skipped) {
                     break;
                 }
+                counters.relabel();
                 my_level = new_level + 1; // relabel
             }
 
+            if constexpr (sequential) {
+                level[u] = my_level;
+                excess[u] = my_excess; // excess left only if my_level >= max_level
+                return work;
+            }
             next_level[u] = my_level; // make relabel visible
-            if (my_excess > 0 && my_level < max_level) { // go again in the next round if excess left
-                push(u);
+            if (my_excess > 0 && my_level < max_level && activate(u)) { // go again in the next round if excess left
+                next_active_handle.push_back(u);
             }
             __atomic_fetch_sub(&excess_diff[u], (excess[u] - my_excess),
                                __ATOMIC_RELAXED); // excess[u] serves as indicator for other nodes that u is active --> update later
             return work;
         }
 
+        template<bool sequential = false>
         size_t dischargeInNode(Node e_in) {
             auto next_active_handle = next_active.local_buffer();
-            auto push = [&](Node v) {
-                if (activate(v))
-                    next_active_handle.push_back(v);
+            auto& counters = instrumentation.local(sequential ? PushRelabelPhase::SequentialDischarge : PushRelabelPhase::Discharge);
+            auto push = [&](Node v, Flow d) {
+                counters.push();
+                if constexpr (sequential) {
+                    touch(v);
+                    excess[v] += d;
+                    if (isTarget(v)) {
+                        flow_value += d;
+                    } else if (activate(v)) {
+                        sequential_queue.push(v);
+                    }
+                } else {
+                    __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
+                    if (activate(v))
+                        next_active_handle.push_back(v);
+                }
             };
             size_t work = 0;
             Flow my_excess = excess[e_in];
@@ -234,66 +388,79 @@ namespace whfc {
 
                 // push through bridge edge
                 if (my_level == level[e_out] + 1) {
-                    if (excess[e_out] > 0 && !winEdge(e_in, e_out)) {
+                    if (!sequential && excess[e_out] > 0 && !winEdge(e_in, e_out)) {
                         skipped = true;
                     } else {
                         const Flow d = std::min(hg.capacity(e) - flow[bridgeEdgeIndex(e)], my_excess);
                         if (d > 0) {
                             flow[bridgeEdgeIndex(e)] += d;
                             my_excess -= d;
-                            __atomic_fetch_add(&excess_diff[e_out], d, __ATOMIC_RELAXED);
-                            push(e_out);
+                            push(e_out, d);
                         }
                     }
                     work++;
                 } else if (my_level <= level[e_out] && flow[bridgeEdgeIndex(e)] < hg.capacity(e)) {
-                    new_level = std::min(new_level, level[e_out]);
+                    new_level = std::min<int>(new_level, level[e_out]);
                 }
 
-                // push back to pins
-                for (const auto& p : hg.pinsOf(e)) {
-                    if (my_excess == 0) {
-                        break;
-                    }
-                    Node v = p.pin;
-                    size_t j = inNodeIncidenceIndex(p.he_inc_iter);
-                    Flow d = flow[j];
-                    if (my_level == level[v] + 1) {
-                        if (excess[v] > 0 && !winEdge(e_in, v)) {
+                // push back to pins. the bridge edge may have taken all excess
+                if (my_excess > 0) {
+                    work += this->template scanPins<true>(e, my_level, new_level, [&](PinIndex pin_ind) {
+                        const Node v = hg.getPin(pin_ind).pin;
+                        const size_t j = inNodeIncidenceIndex(pin_ind);
+                        Flow d = flow[j];
+                        if (!sequential && excess[v] > 0 && !winEdge(e_in, v)) {
                             skipped = true;
                         } else if (d > 0) {
                             d = std::min(d, my_excess);
                             flow[j] -= d;
                             my_excess -= d;
-                            __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
-                            push(v);
+                            push(v, d);
                         }
-                    } else if (d > 0 && my_level <= level[v]) {
-                        new_level = std::min(new_level, level[v]);
-                    }
-                    work++;
+                        return my_excess > 0;
+                    });
                 }
 
                 if (my_excess == 0 || skipped) {
                     break;
                 }
+                counters.relabel();
                 my_level = new_level + 1; // relabel
             }
 
+            if constexpr (sequential) {
+                level[e_in] = my_level;
+                excess[e_in] = my_excess; // excess left only if my_level >= max_level
+                return work;
+            }
             next_level[e_in] = my_level; // make relabel visible
-            if (my_excess > 0 && my_level < max_level) { // go again in the next round if excess left
-                push(e_in);
+            if (my_excess > 0 && my_level < max_level && activate(e_in)) { // go again in the next round if excess left
+                next_active_handle.push_back(e_in);
             }
             __atomic_fetch_sub(&excess_diff[e_in], (excess[e_in] - my_excess),
                                __ATOMIC_RELAXED); // excess[u] serves as indicator for other nodes that u is active --> update later
             return work;
         }
 
+        template<bool sequential = false>
         size_t dischargeOutNode(Node e_out) {
             auto next_active_handle = next_active.local_buffer();
-            auto push = [&](Node v) {
-                if (activate(v))
-                    next_active_handle.push_back(v);
+            auto& counters = instrumentation.local(sequential ? PushRelabelPhase::SequentialDischarge : PushRelabelPhase::Discharge);
+            auto push = [&](Node v, Flow d) {
+                counters.push();
+                if constexpr (sequential) {
+                    touch(v);
+                    excess[v] += d;
+                    if (isTarget(v)) {
+                        flow_value += d;
+                    } else if (activate(v)) {
+                        sequential_queue.push(v);
+                    }
+                } else {
+                    __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
+                    if (activate(v))
+                        next_active_handle.push_back(v);
+                }
             };
             size_t work = 0;
             Flow my_excess = excess[e_out];
@@ -308,29 +475,21 @@ namespace whfc {
                 bool skipped = false;
 
                 // push out to pins
-                for (const auto& p : hg.pinsOf(e)) {
-                    if (my_excess == 0) {
-                        break;
-                    }
-                    Node v = p.pin;
-                    Flow d = my_excess;
-                    if (my_level == level[v] + 1) {
-                        // subtlety here. if target has excess updated (for tracking flow value) winEdge(e_out, v) has to be true if isTarget(v)
-                        // otherwise there's an infinite loop. --> reverted winEdge condition to the original one
-                        if (excess[v] > 0 && !winEdge(e_out, v)) {
-                            skipped = true;
-                        } else {
-                            assert(d > 0 && d <= hg.capacity(e) - flow[outNodeIncidenceIndex(p.he_inc_iter)]);
-                            flow[outNodeIncidenceIndex(p.he_inc_iter)] += d;
-                            my_excess -= d;
-                            __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
-                            push(v);
-                        }
-                    } else if (my_level <= level[v]) {
-                        new_level = std::min(new_level, level[v]);
+                work += this->template scanPins<false>(e, my_level, new_level, [&](PinIndex pin_ind) {
+                    const Node v = hg.getPin(pin_ind).pin;
+                    // subtlety here. if target has excess updated (for tracking flow value) winEdge(e_out, v) has to be true if isTarget(v)
+                    // otherwise there's an infinite loop. --> reverted winEdge condition to the original one
+                    if (!sequential && excess[v] > 0 && !winEdge(e_out, v)) {
+                        skipped = true;
+                    } else {
+                        const Flow d = my_excess;
+                        assert(d > 0 && d <= hg.capacity(e) - flow[outNodeIncidenceIndex(pin_ind)]);
+                        flow[outNodeIncidenceIndex(pin_ind)] += d;
+                        my_excess -= d;
+                        push(v, d);
                     }
-                    work++;
-                }
+                    return my_excess > 0;
+                });
 
                 if (my_excess == 0) {
                     break;
@@ -338,31 +497,36 @@ namespace whfc {
 
                 // push back through bridge edge
                 if (my_level == level[e_in] + 1) {
-                    if (excess[e_in] > 0 && !winEdge(e_out, e_in)) {
+                    if (!sequential && excess[e_in] > 0 && !winEdge(e_out, e_in)) {
                         skipped = true;
                     } else {
-                        Flow d = std::min(flow[bridgeEdgeIndex(e)], my_excess);
+                        Flow d = std::min<Flow>(flow[bridgeEdgeIndex(e)], my_excess);
                         if (d > 0) {
                             flow[bridgeEdgeIndex(e)] -= d;
                             my_excess -= d;
-                            __atomic_fetch_add(&excess_diff[e_in], d, __ATOMIC_RELAXED);
-                            push(e_in);
+                            push(e_in, d);
                         }
                         work++;
                     }
                 } else if (my_level <= level[e_in] && flow[bridgeEdgeIndex(e)] > 0) {
-                    new_level = std::min(new_level, level[e_in]);
+                    new_level = std::min<int>(new_level, level[e_in]);
                 }
 
                 if (my_excess == 0 || skipped) {
                     break;
                 }
+                counters.relabel();
                 my_level = new_level + 1; // relabel
             }
 
+            if constexpr (sequential) {
+                level[e_out] = my_level;
+                excess[e_out] = my_excess; // excess left only if my_level >= max_level
+                return work;
+            }
             next_level[e_out] = my_level; // make relabel visible
-            if (my_excess > 0 && my_level < max_level) { // go again in the next round if excess left
-                push(e_out);
+            if (my_excess > 0 && my_level < max_level && activate(e_out)) { // go again in the next round if excess left
+                next_active_handle.push_back(e_out);
             }
             __atomic_fetch_sub(&excess_diff[e_out], (excess[e_out] - my_excess),
                                __ATOMIC_RELAXED); // excess[u] serves as indicator for other nodes that u is active --> update later
@@ -371,6 +535,7 @@ namespace whfc {
 
         template<bool set_reachability>
         void globalRelabel() {
+            auto phase = instrumentation.scope(PushRelabelPhase::GlobalRelabel);
             auto t = tbb::tick_count::now();
             tbb::parallel_for<size_t>(
                     0, max_level, [&](size_t i) { level[i] = isTarget(Node(i)) ? 0 : max_level; }, tbb::static_partitioner());
@@ -383,14 +548,7 @@ namespace whfc {
                 resetReachability(false);
             }
 
-            auto scan = [&](Node u, int dist) {
-                auto next_layer = next_active.local_buffer();
-                scanBackward(u, [&](const Node v) {
-                    if (!isSource(v) && !isTarget(v) && level[v] == max_level && __atomic_exchange_n(&level[v], dist, __ATOMIC_ACQ_REL) == max_level) {
-                        next_layer.push_back(v);
-                    }
-                });
-
+            auto visit = [&](Node u) {
                 if (!isTarget(u) && excess[u] > 0 && last_activated[u] != round) { // add previously mis-labeled nodes to active queue, if not already contained
                     size_t pos = __atomic_fetch_add(&num_active, 1, __ATOMIC_RELAXED);
                     active[pos] = u;
@@ -398,12 +556,27 @@ namespace whfc {
 
                 if constexpr (set_reachability) {
                     if (!isTarget(u)) {
-                        reach[u] = target_reachable_stamp;
+                        tryReachFromTarget(u);
                     }
                 }
             };
 
-            parallelBFS(0, scan);
+            auto scan = [&](Node u, int dist) {
+                auto next_layer = next_active.local_buffer();
+                instrumentation.local(PushRelabelPhase::GlobalRelabel).scanned(scanLength(u));
+                scanBackward(u, [&](const Node v) {
+                    if (!isSource(v) && !isTarget(v) && level[v] == max_level && __atomic_exchange_n(&level[v], dist, __ATOMIC_ACQ_REL) == max_level) {
+                        next_layer.push_back(v);
+                    }
+                });
+                visit(u);
+            };
+
+            if (direction_optimizing_global_relabel) {
+                directionOptimizingBFS(scan, visit);
+            } else {
+                parallelBFS(0, scan);
+            }
 
             if (set_reachability) {
                 last_target_side_queue_entry = next_active.size();
@@ -415,6 +588,7 @@ namespace whfc {
         }
 
         void deriveSourceSideCut(bool flow_changed) {
+            auto phase = instrumentation.scope(PushRelabelPhase::SourceCut);
             // after global relabel with termination check its container is swapped out --> this function doesn't swap
 
             next_active.clear();
@@ -428,7 +602,7 @@ namespace whfc {
                     if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
                         assert(level[u] == max_level);
                         next_active.push_back_buffered(u);
-                        reach[u] = source_reachable_stamp;
+                        tryReachFromSource(u);
                     }
                 });
                 next_active.finalize();
@@ -443,7 +617,7 @@ namespace whfc {
                     auto next_layer = next_active.local_buffer();
                     scanForward(u, [&](const Node v) {
                         assert(!isTargetReachable(v));
-                        if (!isSourceReachable(v) && __atomic_exchange_n(&reach[v], source_reachable_stamp, __ATOMIC_ACQ_REL) != source_reachable_stamp) {
+                        if (!isSourceReachable(v) && tryReachFromSource(v)) {
                             assert(flow_changed || excess[v] == 0);
                             next_layer.push_back(v);
                         }
@@ -457,7 +631,7 @@ namespace whfc {
                         assert(!isTargetReachable(v));
                         if (!isSourceReachable(v)) {
                             assert(flow_changed || excess[v] == 0);
-                            reach[v] = source_reachable_stamp;
+                            reachFromSource(v);
                             next_active.push_back_atomic(v);
                         }
                     });
@@ -468,7 +642,13 @@ namespace whfc {
             last_source_side_queue_entry = next_active.size();
         }
 
+        // selectable at runtime. in deterministic mode, the order of targetReachableNodes() is independent of the scheduling
+        bool parallel_target_side_cut = true;
+        size_t parallel_bfs_layer_threshold = 2000;
+        size_t num_parallel_bfs_layers = 0;
+
         void deriveTargetSideCut() {
+            auto phase = instrumentation.scope(PushRelabelPhase::TargetCut);
             next_active.swap_container(active); // don't overwrite contents of source side
             next_active.clear();
 
@@ -477,30 +657,27 @@ namespace whfc {
                 next_active.push_back_atomic(t);
             }
 
-            /*
-            auto scan = [&](Node u, int ) {
-                auto next_layer = next_active.local_buffer();
-                scanBackward(u, [&](const Node v) {
-                    assert(!isSourceReachable(v));
-                    if (!isTargetReachable(v) && __atomic_exchange_n(&reach[v], target_reachable_stamp, __ATOMIC_ACQ_REL) != target_reachable_stamp) {
-                        assert(excess[v] == 0);
-                        next_layer.push_back(v);
-                    }
-                });
-            };
-            parallelBFS(0, scan);
-            */
-
-            auto scan = [&](Node u, int) {
-                scanBackward(u, [&](const Node v) {
-                    if (!isTargetReachable(v)) {
-                        reach[v] = target_reachable_stamp;
-                        next_active.push_back_atomic(v);
-                    }
-                });
-            };
-            sequentialBFS(0, scan);
-
+            if (parallel_target_side_cut) {
+                auto scan = [&](Node u, int) {
+                    auto next_layer = next_active.local_buffer();
+                    scanBackward(u, [&](const Node v) {
+                        if (!isTargetReachable(v) && tryReachFromTarget(v)) {
+                            next_layer.push_back(v);
+                        }
+                    });
+                };
+                hybridBFS(0, scan, deterministic);
+            } else {
+                auto scan = [&](Node u, int) {
+                    scanBackward(u, [&](const Node v) {
+                        if (!isTargetReachable(v)) {
+                            reachFromTarget(v);
+                            next_active.push_back_atomic(v);
+                        }
+                    });
+                };
+                sequentialBFS(0, scan);
+            }
 
             last_target_side_queue_entry = next_active.size();
             next_active.swap_container(active); // go back
@@ -519,6 +696,110 @@ namespace whfc {
             }
         }
 
+        /** direction-optimizing global relabeling */
+        // While the frontier is large compared to the unvisited nodes, the BFS runs bottom-up: every unvisited node checks whether it has
+        // a residual edge into the current layer, instead of the frontier scanning its edges and claiming nodes with atomics. cf. Beamer et al.
+        // A layer runs bottom-up if frontier * bottom_up_alpha > unvisited nodes and frontier * bottom_up_beta >= all nodes.
+        bool direction_optimizing_global_relabel = true;
+        size_t bottom_up_alpha = 14, bottom_up_beta = 24;
+        size_t num_bottom_up_layers = 0;
+
+        template<typename ScanFunc, typename VisitFunc>
+        void directionOptimizingBFS(ScanFunc&& scan, VisitFunc&& visit) {
+            size_t first = 0;
+            size_t last = next_active.size();
+            int dist = 1;
+            while (first != last) {
+                const size_t frontier = last - first, unvisited = max_level - last;
+                // level 0 also contains targets that are not piercing nodes. they are not part of the BFS --> start top-down
+                const bool bottom_up = dist > 1 && frontier * bottom_up_alpha > unvisited && frontier * bottom_up_beta >= size_t(max_level);
+                if (bottom_up) {
+                    num_bottom_up_layers++;
+                    tbb::parallel_for<size_t>(first, last, [&](size_t i) { visit(next_active[i]); });
+                    tbb::parallel_for(tbb::blocked_range<size_t>(0, max_level), [&](const tbb::blocked_range<size_t>& r) {
+                        auto next_layer = next_active.local_buffer();
+                        auto& counters = instrumentation.local(PushRelabelPhase::GlobalRelabel);
+                        for (size_t i = r.begin(); i < r.end(); ++i) {
+                            const Node v(i);
+                            if (level[v] == max_level && !isSource(v)) {
+                                counters.scanned(scanLength(v)); // upper bound, hasResidualEdgeToLevel stops at the first hit
+                                if (hasResidualEdgeToLevel(v, dist - 1)) {
+                                    level[v] = dist;
+                                    next_layer.push_back(v);
+                                }
+                            }
+                        }
+                    });
+                } else {
+                    tbb::parallel_for<size_t>(first, last, [&](size_t i) { scan(next_active[i], dist); });
+                }
+                next_active.finalize();
+                first = last;
+                last = next_active.size();
+                dist++;
+            }
+        }
+
+        // whether v has a residual edge to a node on level l. the reverse of scanBackward
+        bool hasResidualEdgeToLevel(Node v, int l) const {
+            if (isHypernode(v)) {
+                for (InHeIndex inc_iter : hg.incidentHyperedgeIndices(v)) {
+                    const Hyperedge e = hg.getInHe(inc_iter).e;
+                    if ((level[edgeToInNode(e)] == l && flow[inNodeIncidenceIndex(inc_iter)] < hg.capacity(e))
+                        || (level[edgeToOutNode(e)] == l && flow[outNodeIncidenceIndex(inc_iter)] > 0)) {
+                        return true;
+                    }
+                }
+            } else if (isOutNode(v)) {
+                const Hyperedge e = outNodeToEdge(v);
+                if (level[edgeToInNode(e)] == l && flow[bridgeEdgeIndex(e)] > 0) {
+                    return true;
+                }
+                for (const auto& p : hg.pinsOf(e)) {
+                    if (level[p.pin] == l) {
+                        return true;
+                    }
+                }
+            } else {
+                const Hyperedge e = inNodeToEdge(v);
+                if (level[edgeToOutNode(e)] == l && flow[bridgeEdgeIndex(e)] < hg.capacity(e)) {
+                    return true;
+                }
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    if (level[hg.getPin(pin_ind).pin] == l && flow[inNodeIncidenceIndex(pin_ind)] > 0) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Scans layers with fewer than parallel_bfs_layer_threshold nodes sequentially. With sort_layers, the parallel layers are sorted,
+        // so that the order of the nodes in the queue does not depend on the scheduling.
+        template<typename ScanFunc>
+        void hybridBFS(size_t first, ScanFunc&& scan, bool sort_layers) {
+            size_t last = next_active.size();
+            int dist = 1;
+            while (first != last) {
+                const bool parallel = last - first >= parallel_bfs_layer_threshold;
+                if (parallel) {
+                    num_parallel_bfs_layers++;
+                    tbb::parallel_for<size_t>(first, last, [&](size_t i) { scan(next_active[i], dist); });
+                } else {
+                    for (size_t i = first; i < last; ++i) {
+                        scan(next_active[i], dist);
+                    }
+                }
+                next_active.finalize();
+                first = last;
+                last = next_active.size();
+                if (parallel && sort_layers) {
+                    tbb::parallel_sort(next_active.begin() + first, next_active.begin() + last);
+                }
+                dist++;
+            }
+        }
+
         template<typename ScanFunc>
         void sequentialBFS(size_t first, ScanFunc&& scan) {
             size_t last = next_active.size();
@@ -537,6 +818,7 @@ namespace whfc {
         sub_range<vec<Node>> targetReachableNodes() const { return sub_range<vec<Node>>(active, 0, last_target_side_queue_entry); }
 
         void saturateSourceEdges() {
+            auto phase = instrumentation.scope(PushRelabelPhase::Saturate);
             /*
              * if no new active nodes are pushed, we proceed straight to the termination checking global relabeling,
              * which then inserts the mis-labeled excess nodes, and then proceeds to the regular main loop
@@ -551,6 +833,7 @@ namespace whfc {
                             Flow d = hg.capacity(e) - flow[inNodeIncidenceIndex(inc_iter)];
                             if (d > 0) {
                                 excess[source] -= d;
+                                touch(e_in);
                                 excess[e_in] += d;
                                 flow[inNodeIncidenceIndex(inc_iter)] += d;
                                 if (activate(e_in)) { // necessary, otherwise global relabel may add them as well --> duplicates
@@ -563,6 +846,7 @@ namespace whfc {
                             Flow d = flow[outNodeIncidenceIndex(inc_iter)];
                             if (d > 0) {
                                 excess[source] -= d;
+                                touch(e_out);
                                 excess[e_out] += d;
                                 flow[outNodeIncidenceIndex(inc_iter)] -= d;
                                 if (activate(e_out)) {
@@ -586,34 +870,43 @@ namespace whfc {
         }
 
         void reset() {
-            PushRelabelCommons::reset();
+            Base::reset();
 
-            excess_diff.assign(max_level, 0);
-            next_level.assign(max_level, 0);
+            resizeArray(excess_diff, max_level, Flow(0));         // zero outside of rounds
+            resizeArray(next_level, max_level, LevelStorage(0)); // written by discharge before it is read
 
             next_active.clear();
+            next_active.set_interleaved(numa_aware);
             next_active.adapt_capacity(max_level);
-            active.resize(max_level);
-            last_activated.assign(max_level, 0);
-            round = 0;
+            if (numa_aware) {
+                interleavedResize(active, max_level);
+            } else {
+                active.resize(max_level);
+            }
+            resizeArray(last_activated, max_level, 0U); // round keeps increasing across resets
 
             last_source_side_queue_entry = 0;
             last_target_side_queue_entry = 0;
+            num_bottom_up_layers = 0;
+            num_parallel_bfs_layers = 0;
+            num_sequential_fallbacks = 0;
+            num_sequential_fallback_exits = 0;
         }
 
-    private:
-        vec<Flow> excess_diff;
-        vec<int> next_level;
+    protected:
+        first_touch_vec<Flow> excess_diff;
+        first_touch_vec<LevelStorage> next_level;
         size_t num_active = 0;
-        BufferedVector<Node> next_active;
+        ChunkedFrontier<Node> next_active;
         vec<Node> active;
+        LayeredQueue<Node> sequential_queue;
 
-        vec<uint32_t> last_activated;
+        first_touch_vec<uint32_t> last_activated;
         uint32_t round = 0;
         bool activate(Node u) { return last_activated[u] != round && __atomic_exchange_n(&last_activated[u], round, __ATOMIC_ACQ_REL) != round; }
         void resetRound() {
             if (++round == 0) {
-                last_activated.assign(max_level, 0);
+                assignArray(last_activated, max_level, 0U);
                 ++round;
             }
             next_active.clear();
@@ -622,4 +915,8 @@ namespace whfc {
         size_t last_source_side_queue_entry = 0, last_target_side_queue_entry = 0;
     };
 
+    using ParallelPushRelabel = BasicParallelPushRelabel<>;
+    // 16-bit flow and level storage. only if CompactParallelPushRelabel::fitsStorage(hg)
+    using CompactParallelPushRelabel = BasicParallelPushRelabel<int16_t, int16_t>;
+
 } // namespace whfc
@@ -4,7 +4,7 @@
 
 #include <tbb/parallel_for.h>
 
-#include "../datastructure/buffered_vector.h"
+#include "../datastructure/chunked_frontier.h"
 #include "../datastructure/flow_hypergraph.h"
 
 
@@ -18,7 +18,9 @@ namespace whfc {
         static constexpr bool log = false;
         static constexpr bool capacitate_incoming_edges_of_in_nodes = true;
 
-        explicit ParallelPushRelabelBlock(FlowHypergraph& hg) : PushRelabelCommons(hg), next_active(0) {}
+        explicit ParallelPushRelabelBlock(FlowHypergraph& hg) : PushRelabelCommons(hg), next_active(0) {
+            sparse_reset = false; // doesn't track touched nodes
+        }
 
         Flow computeMaxFlow(Node s, Node t) {
             reset();
@@ -227,12 +229,13 @@ namespace whfc {
                 }
 
                 // push back to pins
-                for (const auto& p : hg.pinsOf(e)) {
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& p = hg.getPin(pin_ind);
                     if (my_excess == 0) {
                         break;
                     }
                     Node v = p.pin;
-                    size_t j = inNodeIncidenceIndex(p.he_inc_iter);
+                    size_t j = inNodeIncidenceIndex(pin_ind);
                     Flow d = flow[j];
                     if (my_level == level[v] + 1 && d > 0) {
                         if (excess[v] == 0 || updateNodeState(v, LevelState::EXPECT_STABLE)) {
@@ -289,7 +292,8 @@ namespace whfc {
                 bool skipped = false;
 
                 // push out to pins
-                for (const auto& p : hg.pinsOf(e)) {
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& p = hg.getPin(pin_ind);
                     if (my_excess == 0) {
                         break;
                     }
@@ -297,8 +301,8 @@ namespace whfc {
                     Flow d = my_excess;
                     if (my_level == level[v] + 1) {
                         if (excess[v] == 0 || updateNodeState(v, LevelState::EXPECT_STABLE)) {
-                            assert(d > 0 && d <= hg.capacity(e) - flow[outNodeIncidenceIndex(p.he_inc_iter)]);
-                            flow[outNodeIncidenceIndex(p.he_inc_iter)] += d;
+                            assert(d > 0 && d <= hg.capacity(e) - flow[outNodeIncidenceIndex(pin_ind)]);
+                            flow[outNodeIncidenceIndex(pin_ind)] += d;
                             my_excess -= d;
                             __atomic_fetch_add(&excess_diff[v], d, __ATOMIC_RELAXED);
                             push(v);
@@ -435,7 +439,7 @@ namespace whfc {
     private:
         vec<Flow> excess_diff;
         vec<int> next_level;
-        BufferedVector<Node> next_active;
+        ChunkedFrontier<Node> next_active;
         vec<Node> active;
         vec<LevelState> node_state;
         size_t num_active = 0;
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "../datastructure/flow_hypergraph.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VL__)
+#define WHFC_PIN_SCAN_AVX512
+#elif defined(__AVX2__)
+#define WHFC_PIN_SCAN_AVX2
+#endif
+
+#if defined(WHFC_PIN_SCAN_AVX512) || defined(WHFC_PIN_SCAN_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace whfc {
+
+    /*
+     * Kernels for the pin loops of dischargeInNode and dischargeOutNode on large hyperedges. scan() handles a block of width consecutive pins:
+     * it gathers their levels, returns the bitmask of admissible pins (level == my_level - 1) and lowers new_level to the minimum level >= my_level
+     * among the others with residual capacity. For in-nodes, that is flow on the pin edge, read from the block's flow entries, which are contiguous
+     * in the hyperedge-major flow layout. Edges from out-nodes to pins are uncapacitated.
+     * The instruction set is chosen at compile time (-march), the scalar fallback processes the same blocks.
+     */
+    template<typename LevelStorage, typename FlowStorage>
+    class PinScan {
+    public:
+        static_assert(sizeof(FlowHypergraph::Pin) == 8 && std::is_signed<LevelStorage>::value && std::is_signed<FlowStorage>::value);
+        static_assert(sizeof(LevelStorage) == 2 || sizeof(LevelStorage) == 4);
+        static_assert(sizeof(FlowStorage) == 2 || sizeof(FlowStorage) == 4);
+
+#if defined(WHFC_PIN_SCAN_AVX512)
+        static constexpr size_t width = 16;
+
+        template<bool in_node>
+        static uint32_t scan(const FlowHypergraph::Pin* pins, const LevelStorage* level, const FlowStorage* flow, int my_level, int& new_level) {
+            const __m512i first = _mm512_loadu_si512(pins);
+            const __m512i second = _mm512_loadu_si512(pins + 8);
+            const __m512i node_lanes = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+            const __m512i nodes = _mm512_permutex2var_epi32(first, node_lanes, second);
+            const __m512i levels = gatherLevels(nodes, level);
+            const __mmask16 admissible = _mm512_cmpeq_epi32_mask(levels, _mm512_set1_epi32(my_level - 1));
+            __mmask16 candidates = _mm512_cmpge_epi32_mask(levels, _mm512_set1_epi32(my_level));
+            if constexpr (in_node) {
+                candidates &= _mm512_cmpgt_epi32_mask(loadFlow(flow), _mm512_setzero_si512());
+            }
+            if (candidates) {
+                new_level = std::min(new_level, reduceMin(_mm512_mask_blend_epi32(candidates, _mm512_set1_epi32(std::numeric_limits<int>::max()), levels)));
+            }
+            return admissible;
+        }
+
+    private:
+        // the unmasked forms of these intrinsics start from an undefined register in GCC 12, which triggers -Wmaybe-uninitialized
+        static constexpr __mmask16 all_lanes = 0xFFFF;
+
+        static __m512i gatherLevels(__m512i nodes, const LevelStorage* level) {
+            if constexpr (sizeof(LevelStorage) == 4) {
+                return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), all_lanes, nodes, level, 4);
+            } else {
+                // 4-byte loads at 2-byte offsets, then sign-extend the lower half. pins are hypernodes, so level[v + 1] is still in the array
+                const __m512i raw = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), all_lanes, nodes, level, 2);
+                return _mm512_maskz_srai_epi32(all_lanes, _mm512_maskz_slli_epi32(all_lanes, raw, 16), 16);
+            }
+        }
+
+        static __m512i loadFlow(const FlowStorage* flow) {
+            if constexpr (sizeof(FlowStorage) == 4) {
+                return _mm512_loadu_si512(flow);
+            } else {
+                return _mm512_maskz_cvtepi16_epi32(all_lanes, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(flow)));
+            }
+        }
+
+        // rotate by half, quarter, ... and take the minimum, so that lane 0 ends up with the minimum of all lanes
+        static int reduceMin(__m512i x) {
+            x = _mm512_maskz_min_epi32(all_lanes, x, _mm512_maskz_alignr_epi32(all_lanes, x, x, 8));
+            x = _mm512_maskz_min_epi32(all_lanes, x, _mm512_maskz_alignr_epi32(all_lanes, x, x, 4));
+            x = _mm512_maskz_min_epi32(all_lanes, x, _mm512_maskz_alignr_epi32(all_lanes, x, x, 2));
+            x = _mm512_maskz_min_epi32(all_lanes, x, _mm512_maskz_alignr_epi32(all_lanes, x, x, 1));
+            return _mm512_cvtsi512_si32(x);
+        }
+
+#elif defined(WHFC_PIN_SCAN_AVX2)
+        static constexpr size_t width = 8;
+
+        template<bool in_node>
+        static uint32_t scan(const FlowHypergraph::Pin* pins, const LevelStorage* level, const FlowStorage* flow, int my_level, int& new_level) {
+            const __m256 first = _mm256_loadu_ps(reinterpret_cast<const float*>(pins));
+            const __m256 second = _mm256_loadu_ps(reinterpret_cast<const float*>(pins + 4));
+            // nodes 0 1 4 5 | 2 3 6 7, then restore the order of the 64-bit halves
+            const __m256i shuffled = _mm256_castps_si256(_mm256_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m256i nodes = _mm256_permute4x64_epi64(shuffled, _MM_SHUFFLE(3, 1, 2, 0));
+            const __m256i levels = gatherLevels(nodes, level);
+            const __m256i below = _mm256_set1_epi32(my_level - 1);
+            const uint32_t admissible = uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(levels, below))));
+            __m256i candidates = _mm256_cmpgt_epi32(levels, below);
+            if constexpr (in_node) {
+                candidates = _mm256_and_si256(candidates, _mm256_cmpgt_epi32(loadFlow(flow), _mm256_setzero_si256()));
+            }
+            if (!_mm256_testz_si256(candidates, candidates)) {
+                const __m256i m = _mm256_blendv_epi8(_mm256_set1_epi32(std::numeric_limits<int>::max()), levels, candidates);
+                __m128i h = _mm_min_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+                h = _mm_min_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+                h = _mm_min_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+                new_level = std::min(new_level, _mm_cvtsi128_si32(h));
+            }
+            return admissible;
+        }
+
+    private:
+        static __m256i gatherLevels(__m256i nodes, const LevelStorage* level) {
+            const int* base = reinterpret_cast<const int*>(level);
+            if constexpr (sizeof(LevelStorage) == 4) {
+                return _mm256_i32gather_epi32(base, nodes, 4);
+            } else {
+                // see the AVX-512 version
+                const __m256i raw = _mm256_i32gather_epi32(base, nodes, 2);
+                return _mm256_srai_epi32(_mm256_slli_epi32(raw, 16), 16);
+            }
+        }
+
+        static __m256i loadFlow(const FlowStorage* flow) {
+            if constexpr (sizeof(FlowStorage) == 4) {
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(flow));
+            } else {
+                return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flow)));
+            }
+        }
+
+#else
+        static constexpr size_t width = 8;
+
+        template<bool in_node>
+        static uint32_t scan(const FlowHypergraph::Pin* pins, const LevelStorage* level, const FlowStorage* flow, int my_level, int& new_level) {
+            uint32_t admissible = 0;
+            for (size_t k = 0; k < width; ++k) {
+                const int l = level[pins[k].pin];
+                if (l == my_level - 1) {
+                    admissible |= uint32_t(1) << k;
+                } else if (l >= my_level && (!in_node || flow[k] > 0)) {
+                    new_level = std::min(new_level, l);
+                }
+            }
+            return admissible;
+        }
+#endif
+    };
+
+} // namespace whfc
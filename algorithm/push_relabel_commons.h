@@ -1,7 +1,13 @@
 #pragma once
 
+#include "../datastructure/buffered_vector.h"
+#include "../datastructure/epoch_bitset.h"
+#include "../datastructure/flow_assignment.h"
 #include "../datastructure/flow_hypergraph.h"
 #include "../datastructure/queue.h"
+#include "../util/numa.h"
+#include "pin_scan.h"
+#include "push_relabel_instrumentation.h"
 
 #include <tbb/scalable_allocator.h>
 
@@ -9,17 +15,33 @@ namespace whfc {
     template<typename T>
     using vec = std::vector<T, tbb::scalable_allocator<T>>;
 
-    class PushRelabelCommons {
+    // FlowStorage and LevelStorage are the types in which the flow on each edge and the levels are stored.
+    // Narrower types halve the memory traffic, but can only be used if fitsStorage(hg) holds.
+    template<typename FlowStorage, typename LevelStorage>
+    class BasicPushRelabelCommons {
     public:
-        PushRelabelCommons(FlowHypergraph& hg) : hg(hg) {}
+        BasicPushRelabelCommons(FlowHypergraph& hg) : hg(hg) {}
+
+        static bool fitsStorage(const FlowHypergraph& hg) {
+            Flow max_capacity = 0;
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                max_capacity = std::max(max_capacity, hg.capacity(e));
+            }
+            // with capacitated incoming edges of in-nodes, the flow on every edge is bounded by the capacity of its hyperedge.
+            // relabeling can produce max_level + 1
+            const size_t max_level = hg.numNodes() + 2 * hg.numHyperedges();
+            return max_capacity <= std::numeric_limits<FlowStorage>::max() && max_level + 1 <= size_t(std::numeric_limits<LevelStorage>::max());
+        }
 
         static constexpr bool log = false;
 
         FlowHypergraph& hg;
         Flow upper_flow_bound = std::numeric_limits<Flow>::max();
         bool shall_terminate = false;
+        bool deterministic = false;
 
-        double global_relabel_time = 0.0, update_time = 0.0, discharge_time = 0.0, saturate_time = 0.0, source_cut_time = 0.0;
+        double global_relabel_time = 0.0, update_time = 0.0, discharge_time = 0.0, saturate_time = 0.0, source_cut_time = 0.0, sequential_time = 0.0;
+        PushRelabelInstrumentation instrumentation; // per-phase counters, compiled in with WHFC_INSTRUMENTATION
 
         /** mapping between ID types */
         // hypernodes | in-nodes | out-nodes
@@ -49,51 +71,154 @@ namespace whfc {
 
         /** flow assignment */
         Flow flow_value = 0;
-        vec<Flow> flow;
-        vec<Flow> excess;
+        first_touch_vec<FlowStorage> flow;
+        first_touch_vec<Flow> excess;
         size_t out_node_offset = 0, bridge_node_offset = 0;
 
+        // By default, pin-side flow is stored in node order (indexed by InHeIndex). With WHFC_HYPEREDGE_MAJOR_FLOW_LAYOUT defined
+        // (cmake -DWHFC_HYPEREDGE_MAJOR_FLOW_LAYOUT=ON), it is stored in hyperedge order (indexed by PinIndex) instead, so that scans over
+        // the pins of in-nodes and out-nodes read it sequentially, and large hyperedges are scanned with the PinScan kernels.
+        // Scans over the incident hyperedges of a hypernode then translate through InHe::pin_iter, which is next to InHe::e that they read anyway.
+#ifdef WHFC_HYPEREDGE_MAJOR_FLOW_LAYOUT
+        static constexpr bool hyperedge_major_flow_layout = true;
+#else
+        static constexpr bool hyperedge_major_flow_layout = false;
+#endif
+        size_t pinFlowIndex(InHeIndex inc_he_ind) const {
+            if constexpr (hyperedge_major_flow_layout) {
+                return hg.getInHe(inc_he_ind).pin_iter;
+            } else {
+                return inc_he_ind;
+            }
+        }
+        size_t pinFlowIndex(PinIndex pin_ind) const {
+            if constexpr (hyperedge_major_flow_layout) {
+                return pin_ind;
+            } else {
+                return hg.getPin(pin_ind).he_inc_iter;
+            }
+        }
+
         // position where flow going from vertex into hyperedge is stored
-        size_t inNodeIncidenceIndex(InHeIndex inc_he_ind) const { return inc_he_ind; }
+        size_t inNodeIncidenceIndex(InHeIndex inc_he_ind) const { return pinFlowIndex(inc_he_ind); }
+        size_t inNodeIncidenceIndex(PinIndex pin_ind) const { return pinFlowIndex(pin_ind); }
         // position where flow going from hyperedge into vertex is stored
-        size_t outNodeIncidenceIndex(InHeIndex inc_he_ind) const { return inc_he_ind + out_node_offset; }
+        size_t outNodeIncidenceIndex(InHeIndex inc_he_ind) const { return pinFlowIndex(inc_he_ind) + out_node_offset; }
+        size_t outNodeIncidenceIndex(PinIndex pin_ind) const { return pinFlowIndex(pin_ind) + out_node_offset; }
         // position where flow on hyperedge is stored
         size_t bridgeEdgeIndex(Hyperedge he) const { return he + bridge_node_offset; }
 
 
         /** levels */
         int max_level = 0;
-        vec<int> level;
+        first_touch_vec<LevelStorage> level;
+        // engines without distance labels turn this off, then reset() does not allocate level and terminals do not write it
+        bool maintain_levels = true;
         // to avoid concurrently pushing the same edge in different directions
         bool winEdge(Node u, Node v) { return level[u] == level[v] + 1 || level[u] < level[v] - 1 || (level[u] == level[v] && u < v); }
 
+        /** pin scans */
+        // Visits the pins of e in order and calls push(pin_ind) for the admissible ones (level == my_level - 1), until push returns false.
+        // Lowers new_level to the minimum level >= my_level among the other pins with residual capacity, which for in-nodes means flow on
+        // the pin edge. Returns the number of pins up to the one at which the scan stopped.
+        // In the hyperedge-major flow layout, large hyperedges are scanned in blocks with the vectorized PinScan kernels.
+        static constexpr size_t pin_scan_threshold = 32;
+        template<bool in_node, typename F>
+        size_t scanPins(Hyperedge e, int my_level, int& new_level, F&& push) {
+            using Kernel = PinScan<LevelStorage, FlowStorage>;
+            const size_t begin = hg.beginIndexPins(e), end = hg.endIndexPins(e);
+            size_t i = begin;
+            if constexpr (hyperedge_major_flow_layout) {
+                if (end - begin >= pin_scan_threshold) {
+                    for (; i + Kernel::width <= end; i += Kernel::width) {
+                        const FlowStorage* block_flow = in_node ? flow.data() + inNodeIncidenceIndex(PinIndex(i)) : nullptr;
+                        uint32_t admissible = Kernel::template scan<in_node>(&hg.getPin(PinIndex(i)), level.data(), block_flow, my_level, new_level);
+                        for (; admissible != 0; admissible &= admissible - 1) {
+                            const size_t j = i + __builtin_ctz(admissible);
+                            if (!push(PinIndex(j))) {
+                                return j - begin + 1;
+                            }
+                        }
+                    }
+                }
+            }
+            for (; i < end; ++i) {
+                const PinIndex pin_ind(i);
+                const int l = level[hg.getPin(pin_ind).pin];
+                if (l == my_level - 1) {
+                    if (!push(pin_ind)) {
+                        return i - begin + 1;
+                    }
+                } else if (l >= my_level && (!in_node || flow[inNodeIncidenceIndex(pin_ind)] > 0)) {
+                    new_level = std::min(new_level, l);
+                }
+            }
+            return end - begin;
+        }
+
         /** reachability */
-        vec<uint32_t> reach;
-        uint32_t source_reachable_stamp = 0, target_reachable_stamp = 0, running_timestamp = 0;
-        bool isSource(Node u) const { return reach[u] == 1; }
+        // one bitset per set, so that the BFS of each side only reads its own compact arrays, and clearing a set is constant time.
+        // the sets hold at most one state per node: making a node a terminal or reaching it from one side removes it from the sets of
+        // the other side
+        EpochBitset sources, targets, source_reachable, target_reachable;
+        bool isSource(Node u) const { return sources[u]; }
         void makeSource(Node u) {
-            reach[u] = 1;
-            level[u] = max_level;
+            sources.set(u);
+            targets.reset(u);
+            target_reachable.reset(u);
+            if (maintain_levels) {
+                level[u] = max_level;
+            }
+        }
+        bool isSourceReachable(Node u) const { return isSource(u) || source_reachable[u]; }
+        void reachFromSource(Node u) {
+            source_reachable.set(u);
+            target_reachable.reset(u);
+        }
+        // thread-safe version that returns whether u was newly reached
+        bool tryReachFromSource(Node u) {
+            if (!source_reachable.setAtomic(u)) {
+                return false;
+            }
+            if (target_reachable[u]) {
+                target_reachable.resetAtomic(u);
+            }
+            return true;
         }
-        bool isSourceReachable(Node u) const { return isSource(u) || reach[u] == source_reachable_stamp; }
-        void reachFromSource(Node u) { reach[u] = source_reachable_stamp; }
-        bool isTarget(Node u) const { return reach[u] == 2; }
+        bool isTarget(Node u) const { return targets[u]; }
         void makeTarget(Node u) {
-            reach[u] = 2;
-            level[u] = 0;
+            targets.set(u);
+            sources.reset(u);
+            source_reachable.reset(u);
+            if (maintain_levels) {
+                level[u] = 0;
+            }
         }
-        bool isTargetReachable(Node u) const { return isTarget(u) || reach[u] == target_reachable_stamp; }
-        void reachFromTarget(Node u) { reach[u] = target_reachable_stamp; }
-        void unreach(Node u) { reach[u] = 0; }
-        void resetReachability(bool forward) {
-            if (++running_timestamp == 0) {
-                reach.assign(max_level, 0);
-                running_timestamp = 3; // initial value is 2, but the increment is already executed
+        bool isTargetReachable(Node u) const { return isTarget(u) || target_reachable[u]; }
+        void reachFromTarget(Node u) {
+            target_reachable.set(u);
+            source_reachable.reset(u);
+        }
+        bool tryReachFromTarget(Node u) {
+            if (!target_reachable.setAtomic(u)) {
+                return false;
+            }
+            if (source_reachable[u]) {
+                source_reachable.resetAtomic(u);
             }
+            return true;
+        }
+        void unreach(Node u) {
+            sources.reset(u);
+            targets.reset(u);
+            source_reachable.reset(u);
+            target_reachable.reset(u);
+        }
+        void resetReachability(bool forward) {
             if (forward) {
-                source_reachable_stamp = running_timestamp;
+                source_reachable.clear();
             } else {
-                target_reachable_stamp = running_timestamp;
+                target_reachable.clear();
             }
         }
 
@@ -114,6 +239,7 @@ namespace whfc {
             }
         }
         void pierce(Node u, bool source_side) {
+            touch(u);
             if (source_side) {
                 makeSource(u);
                 source_piercing_nodes.push_back(u);
@@ -133,18 +259,44 @@ namespace whfc {
         }
 
         void reset() {
+            const bool sparse = sparse_reset && touched_nodes_complete && touched_nodes.size() <= excess.size() / 2;
+            if (sparse) {
+                clearTouchedEntries(); // uses the offsets of the previous run
+            }
+
             out_node_offset = hg.numPins();
             bridge_node_offset = 2 * hg.numPins();
 
             max_level = hg.numNodes() + 2 * hg.numHyperedges();
 
             flow_value = 0;
-            flow.assign(2 * hg.numPins() + hg.numHyperedges(), 0);
-            excess.assign(max_level, 0);
-            level.assign(max_level, 0);
+            if (sparse) {
+                resizeArray(flow, 2 * hg.numPins() + hg.numHyperedges(), FlowStorage(0));
+                resizeArray(excess, max_level, Flow(0));
+            } else {
+                assignArray(flow, 2 * hg.numPins() + hg.numHyperedges(), FlowStorage(0));
+                assignArray(excess, max_level, Flow(0));
+            }
+            if (maintain_levels) {
+                resizeArray(level, max_level, LevelStorage(0)); // set by the initial global relabeling
+            }
 
-            reach.assign(max_level, 0);
-            running_timestamp = 2;
+            for (EpochBitset* b : { &sources, &targets, &source_reachable, &target_reachable }) {
+                resizeArray(b->words, EpochBitset::numWords(max_level), uint64_t(0));
+                b->clear();
+            }
+
+            if (touch_stamp == std::numeric_limits<uint32_t>::max()) {
+                assignArray(touched, max_level, 0U);
+                touch_stamp = 0;
+            } else {
+                resizeArray(touched, max_level, 0U);
+            }
+            ++touch_stamp;
+            touched_nodes.clear();
+            touched_nodes.set_interleaved(numa_aware);
+            touched_nodes.adapt_capacity(max_level);
+            touched_nodes_complete = true;
 
             work_since_last_global_relabel = std::numeric_limits<size_t>::max();
             global_relabel_work_threshold = (global_relabel_alpha * max_level + 2 * hg.numPins() + hg.numHyperedges()) / global_relabel_frequency;
@@ -158,7 +310,302 @@ namespace whfc {
             distance_labels_broken_from_target_side_piercing = true; // triggers initial global relabeling
         }
 
+        /** NUMA-aware mode */
+        // If enabled, reset() initializes the node- and edge-indexed arrays in parallel with static partitioning, so that their pages
+        // are spread over the sockets like the work on them, and the shared frontier buffers are allocated interleaved.
+        // Only pays off for the parallel engines on multi-socket machines.
+        bool numa_aware = false;
+
+        template<typename T>
+        void resizeArray(first_touch_vec<T>& v, size_t n, const T value) {
+            if (numa_aware) {
+                firstTouchResize(v, n, value);
+            } else {
+                v.resize(n, value);
+            }
+        }
+
+        template<typename T>
+        void assignArray(first_touch_vec<T>& v, size_t n, const T value) {
+            if (numa_aware) {
+                firstTouchAssign(v, n, value);
+            } else {
+                v.assign(n, value);
+            }
+        }
+
+        /** sparse reset */
+        // If enabled, reset() only clears the flow and excess entries the previous run wrote to, instead of all of them.
+        // Every node whose excess changes must be touched by the engine. Both endpoints of an edge with non-zero flow are touched,
+        // so it suffices to record the pin-side flow positions of either the hypernodes or the hyperedges, whichever are contiguous
+        // in the flow layout. They are recorded at the time of touching, since reset() is called after the hypergraph was rebuilt.
+        bool sparse_reset = true;
+        struct TouchedNode {
+            Node u = invalidNode;
+            size_t first_pin_flow = 0, last_pin_flow = 0; // positions of pin-side flow, relative to the in-node half
+            Hyperedge e = invalidHyperedge;               // only for in- and out-nodes
+        };
+        first_touch_vec<uint32_t> touched;
+        uint32_t touch_stamp = 0;
+        BufferedVector<TouchedNode> touched_nodes{ 0 };
+        bool touched_nodes_complete = false;
+
+        bool isTouched(Node u) const { return touched[u] == touch_stamp; }
+        TouchedNode touchedEntry(Node u) {
+            touched[u] = touch_stamp;
+            if (isHypernode(u)) {
+                if constexpr (hyperedge_major_flow_layout) {
+                    return { u, 0, 0, invalidHyperedge };
+                } else {
+                    return { u, hg.beginIndexHyperedges(u), hg.endIndexHyperedges(u), invalidHyperedge };
+                }
+            }
+            const Hyperedge e = isInNode(u) ? inNodeToEdge(u) : outNodeToEdge(u);
+            if constexpr (hyperedge_major_flow_layout) {
+                return { u, hg.beginIndexPins(e), hg.endIndexPins(e), e };
+            } else {
+                return { u, 0, 0, e };
+            }
+        }
+        void touch(Node u) {
+            if (sparse_reset && !isTouched(u)) {
+                touched_nodes.push_back_atomic(touchedEntry(u));
+            }
+        }
+        // for engines that touch the same node from several threads. only the thread that swaps the stamp records u
+        void touchAtomic(Node u) {
+            if (sparse_reset && !isTouched(u) && __atomic_exchange_n(&touched[u], touch_stamp, __ATOMIC_RELAXED) != touch_stamp) {
+                touched_nodes.push_back_atomic(touchedEntry(u));
+            }
+        }
+        void clearTouchedEntries() {
+            for (const TouchedNode& x : touched_nodes) {
+                excess[x.u] = 0;
+                if (x.e != invalidHyperedge) {
+                    flow[bridgeEdgeIndex(x.e)] = 0;
+                }
+                std::fill(flow.begin() + x.first_pin_flow, flow.begin() + x.last_pin_flow, 0);
+                std::fill(flow.begin() + x.first_pin_flow + out_node_offset, flow.begin() + x.last_pin_flow + out_node_offset, 0);
+            }
+        }
+
+        /** warm start */
+        void exportFlow(FlowAssignment& fa) const {
+            fa.clear();
+            fa.flow_value = flow_value;
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                fa.bridge_flow.push_back(flow[bridgeEdgeIndex(e)]);
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    const Flow f_in = flow[inNodeIncidenceIndex(pin_ind)], f_out = flow[outNodeIncidenceIndex(pin_ind)];
+                    if (f_in > 0 || f_out > 0) {
+                        fa.pin_flows.push_back({ pin.pin, f_in, f_out });
+                    }
+                }
+                fa.first_pin_flow.push_back(fa.pin_flows.size());
+            }
+        }
+
+        // Call after reset() and initialize(). Maps the previous flow into the current hypergraph, keeping it where capacities and conservation allow.
+        // Nodes and hyperedges that are dropped map to invalidNode / invalidHyperedge. Deficits are repaired by cancelling flow, excesses stay.
+        void importFlow(const FlowAssignment& fa, const std::vector<Node>& node_mapping, const std::vector<Hyperedge>& hyperedge_mapping) {
+            assert(hyperedge_mapping.size() == fa.numHyperedges());
+            touched_nodes_complete = false; // writes everywhere --> the next reset() clears everything
+            std::vector<PinIndex> pin_position(hg.numNodes(), PinIndex::Invalid());
+            for (Hyperedge old_e(0); old_e < fa.numHyperedges(); ++old_e) {
+                const Hyperedge e = hyperedge_mapping[old_e];
+                if (e == invalidHyperedge) {
+                    continue;
+                }
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    pin_position[pin.pin] = pin_ind;
+                }
+                Flow in_sum = 0, out_sum = 0;
+                for (size_t i = fa.first_pin_flow[old_e]; i < fa.first_pin_flow[old_e + 1]; ++i) {
+                    const auto& pf = fa.pin_flows[i];
+                    const Node v = node_mapping[pf.pin];
+                    if (v != invalidNode && pin_position[v] != PinIndex::Invalid()) {
+                        flow[inNodeIncidenceIndex(pin_position[v])] = std::min(pf.in, hg.capacity(e));
+                        flow[outNodeIncidenceIndex(pin_position[v])] = std::min(pf.out, hg.capacity(e));
+                        in_sum += flow[inNodeIncidenceIndex(pin_position[v])];
+                        out_sum += flow[outNodeIncidenceIndex(pin_position[v])];
+                    }
+                }
+                flow[bridgeEdgeIndex(e)] = std::min({ fa.bridge_flow[old_e], hg.capacity(e), in_sum });
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    auto& f_out = flow[outNodeIncidenceIndex(pin_ind)];
+                    const Flow d = std::min<Flow>(f_out, out_sum - flow[bridgeEdgeIndex(e)]);
+                    if (d > 0) {
+                        f_out -= d;
+                        out_sum -= d;
+                    }
+                    pin_position[pin.pin] = PinIndex::Invalid();
+                }
+            }
+
+            // pin flows of dropped pins may leave deficits. cancel outgoing flow until no non-source node has a deficit
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                Flow& e_in = excess[edgeToInNode(e)];
+                Flow& e_out = excess[edgeToOutNode(e)];
+                e_in -= flow[bridgeEdgeIndex(e)];
+                e_out += flow[bridgeEdgeIndex(e)];
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    const Flow f_in = flow[inNodeIncidenceIndex(pin_ind)], f_out = flow[outNodeIncidenceIndex(pin_ind)];
+                    e_in += f_in;
+                    e_out -= f_out;
+                    excess[pin.pin] += f_out - f_in;
+                }
+            }
+
+            std::vector<Node> deficits;
+            for (int i = 0; i < max_level; ++i) {
+                Node u(i);
+                if (excess[u] < 0 && !isSource(u)) {
+                    deficits.push_back(u);
+                }
+            }
+            auto cancel = [&](auto& f, Node v, Flow& deficit) {
+                const Flow d = std::min<Flow>(f, deficit);
+                if (d > 0) {
+                    f -= d;
+                    deficit -= d;
+                    if (excess[v] >= 0 && excess[v] - d < 0 && !isSource(v)) {
+                        deficits.push_back(v);
+                    }
+                    excess[v] -= d;
+                }
+            };
+            while (!deficits.empty()) {
+                const Node u = deficits.back();
+                deficits.pop_back();
+                Flow deficit = -excess[u];
+                if (isHypernode(u)) {
+                    for (InHeIndex i : hg.incidentHyperedgeIndices(u)) {
+                        cancel(flow[inNodeIncidenceIndex(i)], edgeToInNode(hg.getInHe(i).e), deficit);
+                    }
+                } else if (isInNode(u)) {
+                    cancel(flow[bridgeEdgeIndex(inNodeToEdge(u))], edgeToOutNode(inNodeToEdge(u)), deficit);
+                } else {
+                    for (const PinIndex pin_ind : hg.pinIndices(outNodeToEdge(u))) {
+                        const auto& pin = hg.getPin(pin_ind);
+                        cancel(flow[outNodeIncidenceIndex(pin_ind)], pin.pin, deficit);
+                    }
+                }
+                assert(deficit == 0);
+                excess[u] = 0;
+            }
+
+            flow_value = 0;
+            for (const Node t : target_piercing_nodes) {
+                flow_value += excess[t];
+            }
+        }
+
+        /** residual edges */
+        // calls f(v, residual capacity, flow index, forward) for every residual edge (u,v) until f returns false.
+        // forward means that flow[flow index] is the flow from u to v, otherwise from v to u
+        template<typename F>
+        void forEachResidualEdge(Node u, F&& f) {
+            if (isHypernode(u)) {
+                for (InHeIndex i : hg.incidentHyperedgeIndices(u)) {
+                    const Hyperedge e = hg.getInHe(i).e;
+                    const size_t in = inNodeIncidenceIndex(i), out = outNodeIncidenceIndex(i);
+                    if (flow[in] < hg.capacity(e) && !f(edgeToInNode(e), hg.capacity(e) - flow[in], in, true)) {
+                        return;
+                    }
+                    if (flow[out] > 0 && !f(edgeToOutNode(e), flow[out], out, false)) {
+                        return;
+                    }
+                }
+            } else if (isOutNode(u)) {
+                const Hyperedge e = outNodeToEdge(u);
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    if (!f(hg.getPin(pin_ind).pin, std::numeric_limits<Flow>::max(), outNodeIncidenceIndex(pin_ind), true)) {
+                        return;
+                    }
+                }
+                if (flow[bridgeEdgeIndex(e)] > 0) {
+                    f(edgeToInNode(e), flow[bridgeEdgeIndex(e)], bridgeEdgeIndex(e), false);
+                }
+            } else {
+                const Hyperedge e = inNodeToEdge(u);
+                if (flow[bridgeEdgeIndex(e)] < hg.capacity(e) &&
+                    !f(edgeToOutNode(e), hg.capacity(e) - flow[bridgeEdgeIndex(e)], bridgeEdgeIndex(e), true)) {
+                    return;
+                }
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const size_t in = inNodeIncidenceIndex(pin_ind);
+                    if (flow[in] > 0 && !f(hg.getPin(pin_ind).pin, flow[in], in, false)) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        // same for every residual edge (v,u). forward means that flow[flow index] is the flow from v to u
+        template<typename F>
+        void forEachResidualInEdge(Node u, F&& f) {
+            if (isHypernode(u)) {
+                for (InHeIndex i : hg.incidentHyperedgeIndices(u)) {
+                    const Hyperedge e = hg.getInHe(i).e;
+                    const size_t in = inNodeIncidenceIndex(i), out = outNodeIncidenceIndex(i);
+                    if (flow[in] > 0 && !f(edgeToInNode(e), flow[in], in, false)) {
+                        return;
+                    }
+                    if (!f(edgeToOutNode(e), std::numeric_limits<Flow>::max(), out, true)) {
+                        return;
+                    }
+                }
+            } else if (isOutNode(u)) {
+                const Hyperedge e = outNodeToEdge(u);
+                if (flow[bridgeEdgeIndex(e)] < hg.capacity(e) &&
+                    !f(edgeToInNode(e), hg.capacity(e) - flow[bridgeEdgeIndex(e)], bridgeEdgeIndex(e), true)) {
+                    return;
+                }
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const size_t out = outNodeIncidenceIndex(pin_ind);
+                    if (flow[out] > 0 && !f(hg.getPin(pin_ind).pin, flow[out], out, false)) {
+                        return;
+                    }
+                }
+            } else {
+                const Hyperedge e = inNodeToEdge(u);
+                if (flow[bridgeEdgeIndex(e)] > 0 && !f(edgeToOutNode(e), flow[bridgeEdgeIndex(e)], bridgeEdgeIndex(e), false)) {
+                    return;
+                }
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const size_t in = inNodeIncidenceIndex(pin_ind);
+                    if (flow[in] < hg.capacity(e) && !f(hg.getPin(pin_ind).pin, hg.capacity(e) - flow[in], in, true)) {
+                        return;
+                    }
+                }
+            }
+        }
+
+        // residual capacity of the edge (u,v) that f was called with
+        Flow residualCapacity(Node u, Node v, size_t flow_index, bool forward) const {
+            if (!forward) {
+                return flow[flow_index];
+            }
+            if (isOutNode(u)) {
+                return std::numeric_limits<Flow>::max();
+            }
+            const Hyperedge e = isInNode(u) ? inNodeToEdge(u) : inNodeToEdge(v);
+            return hg.capacity(e) - flow[flow_index];
+        }
+
         /** BFS stuff */
+        // the number of arcs scanBackward and scanForward look at
+        size_t scanLength(Node u) const {
+            if (isHypernode(u)) {
+                return hg.degree(u);
+            }
+            return hg.pinCount(isOutNode(u) ? outNodeToEdge(u) : inNodeToEdge(u)) + 1;
+        }
+
         template<typename PushFunc>
         void scanBackward(Node u, PushFunc&& push) {
             if (isHypernode(u)) {
@@ -174,8 +621,9 @@ namespace whfc {
                 if (flow[bridgeEdgeIndex(e)] < hg.capacity(e)) {
                     push(edgeToInNode(e));
                 }
-                for (const auto& pin : hg.pinsOf(e)) {
-                    if (flow[outNodeIncidenceIndex(pin.he_inc_iter)] > 0) {
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    if (flow[outNodeIncidenceIndex(pin_ind)] > 0) {
                         push(pin.pin);
                     }
                 }
@@ -185,8 +633,9 @@ namespace whfc {
                 if (flow[bridgeEdgeIndex(e)] > 0) {
                     push(edgeToOutNode(e));
                 }
-                for (const auto& pin : hg.pinsOf(e)) {
-                    if (flow[inNodeIncidenceIndex(pin.he_inc_iter)] < hg.capacity(e)) {
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    if (flow[inNodeIncidenceIndex(pin_ind)] < hg.capacity(e)) {
                         push(pin.pin);
                     }
                 }
@@ -220,12 +669,15 @@ namespace whfc {
                 if (flow[bridgeEdgeIndex(e)] < hg.capacity(e)) {
                     push(edgeToOutNode(e));
                 }
-                for (const auto& pin : hg.pinsOf(e)) {
-                    if (flow[inNodeIncidenceIndex(pin.he_inc_iter)] > 0) {
+                for (const PinIndex pin_ind : hg.pinIndices(e)) {
+                    const auto& pin = hg.getPin(pin_ind);
+                    if (flow[inNodeIncidenceIndex(pin_ind)] > 0) {
                         push(pin.pin);
                     }
                 }
             }
         }
     };
+
+    using PushRelabelCommons = BasicPushRelabelCommons<Flow, int>;
 } // namespace whfc
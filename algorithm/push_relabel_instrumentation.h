@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+#include <string>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/tick_count.h>
+
+#include "../util/perf_counters.h"
+
+namespace whfc {
+
+#ifdef WHFC_INSTRUMENTATION
+    static constexpr bool instrumentation_enabled = true;
+#else
+    static constexpr bool instrumentation_enabled = false;
+#endif
+
+    enum class PushRelabelPhase : uint8_t { Saturate, Discharge, SequentialDischarge, ApplyUpdates, GlobalRelabel, SourceCut, TargetCut };
+    static constexpr size_t num_push_relabel_phases = 7;
+
+    inline const char* phaseName(PushRelabelPhase p) {
+        static constexpr const char* names[num_push_relabel_phases] = { "saturate",        "discharge",  "sequential discharge", "apply updates",
+                                                                        "global relabel", "source cut", "target cut" };
+        return names[static_cast<size_t>(p)];
+    }
+
+    struct PushRelabelPhaseStatistics {
+        size_t rounds = 0; // how often the phase ran. for global relabel, the number of global relabels
+        size_t active_nodes = 0, pushes = 0, relabels = 0, edges_scanned = 0;
+        double seconds = 0.0;
+        bool has_perf_counters = false;
+        uint64_t instructions = 0, cache_misses = 0; // of the thread that ran the phase, i.e., without TBB workers in parallel phases
+    };
+
+    /*
+     * Per-phase counters of the push-relabel engines. Compiled in only with WHFC_INSTRUMENTATION defined (cmake -DWHFC_INSTRUMENTATION=ON),
+     * otherwise every call is a no-op. Rounds, time and perf counters are taken by begin / end on the thread that runs the phase.
+     * Pushes, relabels, edges scanned and active nodes go to thread-local counters, which discharge functions get once via local(phase).
+     * Statistics accumulate over runs, like the timing fields of the engines, until clear().
+     */
+    template<bool enabled>
+    class BasicPushRelabelInstrumentation {
+    public:
+        struct Counters {
+            size_t active_nodes = 0, pushes = 0, relabels = 0, edges_scanned = 0;
+            void push() { pushes++; }
+            void relabel() { relabels++; }
+            void scanned(size_t n) { edges_scanned += n; }
+            void activeNodes(size_t n) { active_nodes += n; }
+        };
+
+        Counters& local(PushRelabelPhase p) { return counters.local()[index(p)]; }
+
+        void begin(PushRelabelPhase p) {
+            Running& r = running[index(p)];
+            r.start = tbb::tick_count::now();
+            r.perf = PerfCounters::threadLocal().read();
+        }
+
+        void end(PushRelabelPhase p) {
+            const PerfCounters::Values perf = PerfCounters::threadLocal().read();
+            Running& r = running[index(p)];
+            PushRelabelPhaseStatistics& s = phases[index(p)];
+            s.rounds++;
+            s.seconds += (tbb::tick_count::now() - r.start).seconds();
+            if (perf.available && r.perf.available) {
+                s.has_perf_counters = true;
+                s.instructions += perf.instructions - r.perf.instructions;
+                s.cache_misses += perf.cache_misses - r.perf.cache_misses;
+            }
+        }
+
+        class Scope {
+        public:
+            Scope(BasicPushRelabelInstrumentation& instrumentation, PushRelabelPhase p) : instrumentation(instrumentation), p(p) { instrumentation.begin(p); }
+            ~Scope() { instrumentation.end(p); }
+
+        private:
+            BasicPushRelabelInstrumentation& instrumentation;
+            PushRelabelPhase p;
+        };
+
+        Scope scope(PushRelabelPhase p) { return Scope(*this, p); }
+
+        PushRelabelPhaseStatistics statistics(PushRelabelPhase p) const {
+            PushRelabelPhaseStatistics s = phases[index(p)];
+            for (const auto& c : counters) {
+                const Counters& x = c[index(p)];
+                s.active_nodes += x.active_nodes;
+                s.pushes += x.pushes;
+                s.relabels += x.relabels;
+                s.edges_scanned += x.edges_scanned;
+            }
+            return s;
+        }
+
+        void clear() {
+            counters.clear();
+            phases = {};
+        }
+
+        void writeJSON(std::ostream& os, const std::string& name) const {
+            os << "{\"name\":\"";
+            for (const char c : name) {
+                if (c == '"' || c == '\\') {
+                    os << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) { // control characters must be escaped as well
+                    static constexpr const char* hex = "0123456789abcdef";
+                    os << "\\u00" << hex[c >> 4] << hex[c & 15];
+                } else {
+                    os << c;
+                }
+            }
+            os << "\",\"phases\":[";
+            for (size_t i = 0; i < num_push_relabel_phases; ++i) {
+                const auto p = static_cast<PushRelabelPhase>(i);
+                const PushRelabelPhaseStatistics s = statistics(p);
+                os << (i > 0 ? "," : "") << "{\"phase\":\"" << phaseName(p) << "\",\"rounds\":" << s.rounds << ",\"active_nodes\":" << s.active_nodes
+                   << ",\"pushes\":" << s.pushes << ",\"relabels\":" << s.relabels << ",\"edges_scanned\":" << s.edges_scanned << ",\"seconds\":" << s.seconds;
+                if (s.has_perf_counters) {
+                    os << ",\"instructions\":" << s.instructions << ",\"cache_misses\":" << s.cache_misses;
+                }
+                os << "}";
+            }
+            os << "]}\n";
+        }
+
+        static void writeCSVHeader(std::ostream& os) { os << "name,phase,rounds,active_nodes,pushes,relabels,edges_scanned,seconds,instructions,cache_misses\n"; }
+
+        // perf counter columns stay empty if not available
+        void writeCSV(std::ostream& os, const std::string& name) const {
+            for (size_t i = 0; i < num_push_relabel_phases; ++i) {
+                const auto p = static_cast<PushRelabelPhase>(i);
+                const PushRelabelPhaseStatistics s = statistics(p);
+                os << name << "," << phaseName(p) << "," << s.rounds << "," << s.active_nodes << "," << s.pushes << "," << s.relabels << ","
+                   << s.edges_scanned << "," << s.seconds << ",";
+                if (s.has_perf_counters) {
+                    os << s.instructions << "," << s.cache_misses;
+                } else {
+                    os << ",";
+                }
+                os << "\n";
+            }
+        }
+
+    private:
+        struct Running {
+            tbb::tick_count start;
+            PerfCounters::Values perf;
+        };
+
+        static size_t index(PushRelabelPhase p) { return static_cast<size_t>(p); }
+
+        tbb::enumerable_thread_specific<std::array<Counters, num_push_relabel_phases>> counters;
+        std::array<Running, num_push_relabel_phases> running;
+        std::array<PushRelabelPhaseStatistics, num_push_relabel_phases> phases;
+    };
+
+    template<>
+    class BasicPushRelabelInstrumentation<false> {
+    public:
+        struct Counters {
+            void push() {}
+            void relabel() {}
+            void scanned(size_t) {}
+            void activeNodes(size_t) {}
+        };
+
+        Counters& local(PushRelabelPhase) { return dummy; }
+        void begin(PushRelabelPhase) {}
+        void end(PushRelabelPhase) {}
+        struct Scope {
+            ~Scope() {} // not trivial, so that unused scopes do not warn
+        };
+        Scope scope(PushRelabelPhase) { return {}; }
+        PushRelabelPhaseStatistics statistics(PushRelabelPhase) const { return {}; }
+        void clear() {}
+        void writeJSON(std::ostream&, const std::string&) const {}
+        static void writeCSVHeader(std::ostream&) {}
+        void writeCSV(std::ostream&, const std::string&) const {}
+
+    private:
+        Counters dummy;
+    };
+
+    using PushRelabelInstrumentation = BasicPushRelabelInstrumentation<instrumentation_enabled>;
+
+} // namespace whfc
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <queue>
 #include <vector>
 
+#include "../datastructure/active_node_selection.h"
 #include "../datastructure/buffered_vector.h"
 #include "../datastructure/flow_hypergraph.h"
 #include "push_relabel_commons.h"
@@ -13,30 +13,76 @@ namespace whfc {
     template<typename T>
     using vec = std::vector<T, tbb::scalable_allocator<T>>;
 
-    class SequentialPushRelabel : public PushRelabelCommons {
+    // Selection is the policy that picks the next active node, see active_node_selection.h
+    template<typename FlowStorage = Flow, typename LevelStorage = int, typename Selection = FIFOSelection>
+    class BasicSequentialPushRelabel : public BasicPushRelabelCommons<FlowStorage, LevelStorage> {
     public:
-        using Type = SequentialPushRelabel;
+        using Base = BasicPushRelabelCommons<FlowStorage, LevelStorage>;
+        using Base::hg;
+        using Base::flow;
+        using Base::excess;
+        using Base::level;
+        using Base::reachFromSource;
+        using Base::reachFromTarget;
+        using Base::max_level;
+        using Base::flow_value;
+        using Base::upper_flow_bound;
+        using Base::shall_terminate;
+        using Base::isHypernode;
+        using Base::isOutNode;
+        using Base::inNodeToEdge;
+        using Base::outNodeToEdge;
+        using Base::edgeToInNode;
+        using Base::edgeToOutNode;
+        using Base::inNodeIncidenceIndex;
+        using Base::outNodeIncidenceIndex;
+        using Base::bridgeEdgeIndex;
+        using Base::isSource;
+        using Base::isTarget;
+        using Base::isSourceReachable;
+        using Base::isTargetReachable;
+        using Base::resetReachability;
+        using Base::work_since_last_global_relabel;
+        using Base::global_relabel_work_threshold;
+        using Base::distance_labels_broken_from_target_side_piercing;
+        using Base::source_piercing_nodes;
+        using Base::target_piercing_nodes;
+        using Base::source_piercing_nodes_not_exhausted;
+        using Base::scanForward;
+        using Base::scanBackward;
+        using Base::scanLength;
+        using Base::touch;
+        using Base::instrumentation;
+        using Base::initialize;
+
+        using Type = BasicSequentialPushRelabel;
         static constexpr bool log = false;
         static constexpr bool capacitate_incoming_edges_of_in_nodes = true;
 
-        explicit SequentialPushRelabel(FlowHypergraph& hg) : PushRelabelCommons(hg) {}
+        explicit BasicSequentialPushRelabel(FlowHypergraph& hg) : Base(hg) {}
 
 
         bool findMinCuts() {
             saturateSourceEdges();
             globalRelabel(); // previous excess nodes have been relabeled to max_level and there is no back-up check to reinsert them
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
+            instrumentation.begin(PushRelabelPhase::Discharge); // a round of the sequential engine lasts until the next global relabeling
             while (!active.empty()) {
                 if (flow_value > upper_flow_bound || shall_terminate) {
+                    instrumentation.end(PushRelabelPhase::Discharge);
                     return false;
                 }
                 if (work_since_last_global_relabel > global_relabel_work_threshold) {
+                    instrumentation.end(PushRelabelPhase::Discharge);
                     globalRelabel();
+                    instrumentation.begin(PushRelabelPhase::Discharge);
+                    continue; // with the gap heuristic, the active nodes are rebuilt
                 }
-                const Node u = active.front();
-                active.pop();
+                const Node u = active.pop();
                 if (excess[u] == 0 || level[u] >= max_level) {
                     continue;
                 }
+                const size_t work_before = work_since_last_global_relabel;
                 if (isHypernode(u)) {
                     work_since_last_global_relabel += dischargeHypernode(u);
                 } else if (isOutNode(u)) {
@@ -44,7 +90,10 @@ namespace whfc {
                 } else {
                     work_since_last_global_relabel += dischargeInNode(u);
                 }
+                counters.activeNodes(1);
+                counters.scanned(work_since_last_global_relabel - work_before);
             }
+            instrumentation.end(PushRelabelPhase::Discharge);
             LOGGER << V(flow_value);
 
             deriveSourceSideCut(true);
@@ -52,8 +101,16 @@ namespace whfc {
             return true;
         }
 
+        Flow computeMaxFlow(Node s, Node t) {
+            reset();
+            initialize(s, t);
+            findMinCuts();
+            return flow_value;
+        }
+
         size_t dischargeHypernode(Node u) {
             size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
             Flow my_excess = excess[u];
             int my_level = level[u];
 
@@ -77,12 +134,14 @@ namespace whfc {
                             if (isTarget(e_in)) {
                                 flow_value += d;
                             } else if (excess[e_in] == 0) {
-                                active.push(e_in);
+                                active.push(e_in, level[e_in]);
                             }
+                            touch(e_in);
                             excess[e_in] += d;
+                            counters.push();
                         }
                     } else if (my_level <= level[e_in] && d > 0) {
-                        new_level = std::min(new_level, level[e_in]);
+                        new_level = std::min<int>(new_level, level[e_in]);
                     }
                 }
                 work += i - hg.beginIndexHyperedges(u);
@@ -97,19 +156,21 @@ namespace whfc {
                     Node e_out = edgeToOutNode(e);
                     if (my_level == level[e_out] + 1) {
                         assert(flow[outNodeIncidenceIndex(i)] <= hg.capacity(e));
-                        const Flow d = std::min(my_excess, flow[outNodeIncidenceIndex(i)]);
+                        const Flow d = std::min<Flow>(my_excess, flow[outNodeIncidenceIndex(i)]);
                         if (d > 0) {
                             flow[outNodeIncidenceIndex(i)] -= d;
                             my_excess -= d;
                             if (isTarget(e_out)) {
                                 flow_value += d;
                             } else if (excess[e_out] == 0) {
-                                active.push(e_out);
+                                active.push(e_out, level[e_out]);
                             }
+                            touch(e_out);
                             excess[e_out] += d;
+                            counters.push();
                         }
                     } else if (my_level <= level[e_out] && flow[outNodeIncidenceIndex(i)] > 0) {
-                        new_level = std::min(new_level, level[e_out]);
+                        new_level = std::min<int>(new_level, level[e_out]);
                     }
                 }
                 work += i - hg.beginIndexHyperedges(u);
@@ -117,12 +178,13 @@ namespace whfc {
                 if (my_excess == 0) {
                     break;
                 }
-                my_level = new_level + 1; // relabel
+                counters.relabel();
+                my_level = relabel(u, my_level, new_level + 1);
             }
 
             level[u] = my_level; // make relabel visible
             if (my_level < max_level && my_excess > 0) { // go again in the next round if excess left
-                active.push(u);
+                active.push(u, level[u]);
             }
             excess[u] = my_excess;
 
@@ -131,6 +193,7 @@ namespace whfc {
 
         size_t dischargeInNode(Node e_in) {
             size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
             Flow my_excess = excess[e_in];
             int my_level = level[e_in];
             Hyperedge e = inNodeToEdge(e_in);
@@ -149,26 +212,25 @@ namespace whfc {
                         if (isTarget(e_out)) {
                             flow_value += d;
                         } else if (excess[e_out] == 0) {
-                            active.push(e_out);
+                            active.push(e_out, level[e_out]);
                         }
+                        touch(e_out);
                         excess[e_out] += d;
+                        counters.push();
                     }
                 } else if (my_level <= level[e_out] && flow[bridgeEdgeIndex(e)] < hg.capacity(e)) {
-                    new_level = std::min(new_level, level[e_out]);
+                    new_level = std::min<int>(new_level, level[e_out]);
                 }
 
-                // push back to pins
-                for (const auto& p : hg.pinsOf(e)) {
-                    if (my_excess == 0) {
-                        break;
-                    }
-                    Node v = p.pin;
-                    size_t j = inNodeIncidenceIndex(p.he_inc_iter);
-                    Flow d = flow[j];
-                    if constexpr (capacitate_incoming_edges_of_in_nodes) {
-                        assert(d <= hg.capacity(e));
-                    }
-                    if (my_level == level[v] + 1) {
+                // push back to pins. the bridge edge may have taken all excess
+                if (my_excess > 0) {
+                    this->template scanPins<true>(e, my_level, new_level, [&](PinIndex pin_ind) {
+                        const Node v = hg.getPin(pin_ind).pin;
+                        const size_t j = inNodeIncidenceIndex(pin_ind);
+                        Flow d = flow[j];
+                        if constexpr (capacitate_incoming_edges_of_in_nodes) {
+                            assert(d <= hg.capacity(e));
+                        }
                         if (d > 0) {
                             d = std::min(d, my_excess);
                             flow[j] -= d;
@@ -176,25 +238,27 @@ namespace whfc {
                             if (isTarget(v)) {
                                 flow_value += d;
                             } else if (excess[v] == 0) {
-                                active.push(v);
+                                active.push(v, level[v]);
                             }
+                            touch(v);
                             excess[v] += d;
+                            counters.push();
                         }
-                    } else if (my_level <= level[v] && d > 0) {
-                        new_level = std::min(new_level, level[v]);
-                    }
+                        return my_excess > 0;
+                    });
                 }
                 work += hg.pinCount(e) + 6;
 
                 if (my_excess == 0) {
                     break;
                 }
-                my_level = new_level + 1; // relabel
+                counters.relabel();
+                my_level = relabel(e_in, my_level, new_level + 1);
             }
 
             level[e_in] = my_level; // make relabel visible
             if (my_level < max_level && my_excess > 0) { // go again in the next round if excess left
-                active.push(e_in);
+                active.push(e_in, level[e_in]);
             }
             excess[e_in] = my_excess;
             return work;
@@ -202,6 +266,7 @@ namespace whfc {
 
         size_t dischargeOutNode(Node e_out) {
             size_t work = 0;
+            auto& counters = instrumentation.local(PushRelabelPhase::Discharge);
             Flow my_excess = excess[e_out];
             int my_level = level[e_out];
             Hyperedge e = outNodeToEdge(e_out);
@@ -213,26 +278,22 @@ namespace whfc {
                 int new_level = max_level - 1;
 
                 // push out to pins
-                for (const auto& p : hg.pinsOf(e)) {
-                    if (my_excess == 0) {
-                        break;
-                    }
-                    Node v = p.pin;
-                    Flow d = my_excess;
-                    if (my_level == level[v] + 1) {
-                        assert(d <= hg.capacity(e) - flow[outNodeIncidenceIndex(p.he_inc_iter)]);
-                        flow[outNodeIncidenceIndex(p.he_inc_iter)] += d;
-                        my_excess -= d;
-                        if (isTarget(v)) {
-                            flow_value += d;
-                        } else if (excess[v] == 0) {
-                            active.push(v);
-                        }
-                        excess[v] += d;
-                    } else if (my_level <= level[v] && d > 0) {
-                        new_level = std::min(new_level, level[v]);
+                this->template scanPins<false>(e, my_level, new_level, [&](PinIndex pin_ind) {
+                    const Node v = hg.getPin(pin_ind).pin;
+                    const Flow d = my_excess;
+                    assert(d <= hg.capacity(e) - flow[outNodeIncidenceIndex(pin_ind)]);
+                    flow[outNodeIncidenceIndex(pin_ind)] += d;
+                    my_excess -= d;
+                    if (isTarget(v)) {
+                        flow_value += d;
+                    } else if (excess[v] == 0) {
+                        active.push(v, level[v]);
                     }
-                }
+                    touch(v);
+                    excess[v] += d;
+                    counters.push();
+                    return my_excess > 0;
+                });
                 work += hg.pinCount(e) + 6;
 
                 if (my_excess == 0) {
@@ -241,36 +302,62 @@ namespace whfc {
 
                 // push back through bridge edge
                 if (my_level == level[e_in] + 1) {
-                    Flow d = std::min(flow[bridgeEdgeIndex(e)], my_excess);
+                    Flow d = std::min<Flow>(flow[bridgeEdgeIndex(e)], my_excess);
                     if (d > 0) {
                         flow[bridgeEdgeIndex(e)] -= d;
                         my_excess -= d;
                         if (isTarget(e_in)) {
                             flow_value += d;
                         } else if (excess[e_in] == 0) {
-                            active.push(e_in);
+                            active.push(e_in, level[e_in]);
                         }
+                        touch(e_in);
                         excess[e_in] += d;
+                        counters.push();
                     }
                 } else if (my_level <= level[e_in] && flow[bridgeEdgeIndex(e)] > 0) {
-                    new_level = std::min(new_level, level[e_in]);
+                    new_level = std::min<int>(new_level, level[e_in]);
                 }
 
                 if (my_excess == 0) {
                     break;
                 }
-                my_level = new_level + 1; // relabel
+                counters.relabel();
+                my_level = relabel(e_out, my_level, new_level + 1);
             }
 
             level[e_out] = my_level; // make relabel visible
             if (my_level < max_level && my_excess > 0) { // go again in the next round if excess left
-                active.push(e_out);
+                active.push(e_out, level[e_out]);
             }
             excess[e_out] = my_excess;
             return work;
         }
 
+        size_t num_gaps = 0;
+
+        // returns the new level of u. with the gap heuristic, if u was the last node on its old level, u and all nodes above are cut off from the target
+        int relabel(Node u, int old_level, int new_level) {
+            if constexpr (Selection::gap_heuristic) {
+                assert(old_level > 0 && old_level < max_level);
+                active.removeFromBucket(u, old_level);
+                if (active.bucketEmpty(old_level)) {
+                    num_gaps++;
+                    active.removeAbove(old_level, [&](const Node v) { level[v] = max_level; });
+                    return max_level;
+                }
+                if (new_level < max_level) {
+                    active.addToBucket(u, new_level);
+                }
+            } else {
+                unused(u, old_level);
+            }
+            return new_level;
+        }
+
         void globalRelabel() {
+            auto phase = instrumentation.scope(PushRelabelPhase::GlobalRelabel);
+            auto& counters = instrumentation.local(PushRelabelPhase::GlobalRelabel);
             for (int i = 0; i < max_level; ++i) {
                 level[i] = isTarget(Node(i)) ? 0 : max_level;
             }
@@ -279,6 +366,7 @@ namespace whfc {
                 relabel_queue.push_back(t);
             }
             auto scan = [&](Node u, int dist) {
+                counters.scanned(scanLength(u));
                 scanBackward(u, [&](const Node v) {
                     if (!isSource(v) && !isTarget(v) && level[v] == max_level) {
                         relabel_queue.push_back(v);
@@ -289,9 +377,25 @@ namespace whfc {
             sequentialBFS(relabel_queue, scan);
             work_since_last_global_relabel = 0;
             distance_labels_broken_from_target_side_piercing = false;
+
+            if constexpr (Selection::gap_heuristic) {
+                // levels changed --> rebuild the buckets
+                active.clear();
+                active.clearBuckets();
+                for (int i = 0; i < max_level; ++i) {
+                    const Node u(i);
+                    if (level[u] < max_level && !isTarget(u)) {
+                        active.addToBucket(u, level[u]);
+                        if (excess[u] > 0) {
+                            active.push(u, level[u]);
+                        }
+                    }
+                }
+            }
         }
 
         void deriveSourceSideCut(bool flow_changed) {
+            auto phase = instrumentation.scope(PushRelabelPhase::SourceCut);
             source_reachable_nodes.clear();
             if (flow_changed) {
                 resetReachability(true); // if flow didn't change, we can reuse the old stamp
@@ -300,7 +404,7 @@ namespace whfc {
                     if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
                         assert(level[u] == max_level);
                         source_reachable_nodes.push_back(u);
-                        reach[u] = source_reachable_stamp;
+                        reachFromSource(u);
                     }
                 }
                 LOGGER << V(source_reachable_nodes.size()) << "excess nodes";
@@ -315,7 +419,7 @@ namespace whfc {
                     assert(!isTarget(v));
                     if (!isSourceReachable(v)) {
                         assert(flow_changed || excess[v] == 0);
-                        reach[v] = source_reachable_stamp;
+                        reachFromSource(v);
                         source_reachable_nodes.push_back(v);
                     }
                 });
@@ -324,6 +428,7 @@ namespace whfc {
         }
 
         void deriveTargetSideCut() {
+            auto phase = instrumentation.scope(PushRelabelPhase::TargetCut);
             relabel_queue.clear();
             resetReachability(false);
             for (const Node t : target_piercing_nodes) {
@@ -334,7 +439,7 @@ namespace whfc {
                     assert(!isSourceReachable(v));
                     if (!isTargetReachable(v)) {
                         assert(excess[v] == 0);
-                        reach[v] = target_reachable_stamp;
+                        reachFromTarget(v);
                         relabel_queue.push_back(v);
                     }
                 });
@@ -361,9 +466,8 @@ namespace whfc {
 
 
         void saturateSourceEdges() {
-            while (!active.empty()) {
-                active.pop();
-            }
+            auto phase = instrumentation.scope(PushRelabelPhase::Saturate);
+            active.clear();
 
             for (Node u : source_reachable_nodes) {
                 if (excess[u] <= 0 || isSource(u)) { // all excess nodes are at the beginning
@@ -371,7 +475,7 @@ namespace whfc {
                 }
                 assert(level[u] == max_level || isTarget(u)); // can have target piercing nodes in there...
                 if (!isTarget(u)) {
-                    active.push(u);
+                    active.push(u, level[u]);
                 }
             }
 
@@ -393,8 +497,9 @@ namespace whfc {
                             if (d > 0) {
                                 excess[source] -= d;
                                 if (excess[e_in] == 0) {
-                                    active.push(e_in);
+                                    active.push(e_in, level[e_in]);
                                 }
+                                touch(e_in);
                                 excess[e_in] += d;
                                 flow[inNodeIncidenceIndex(inc_iter)] += d;
                             }
@@ -405,8 +510,9 @@ namespace whfc {
                             if (d > 0) {
                                 excess[source] -= d;
                                 if (excess[e_out] == 0) {
-                                    active.push(e_out);
+                                    active.push(e_out, level[e_out]);
                                 }
+                                touch(e_out);
                                 excess[e_out] += d;
                                 flow[outNodeIncidenceIndex(inc_iter)] -= d;
                             }
@@ -427,19 +533,37 @@ namespace whfc {
         }
 
         void reset() {
-            PushRelabelCommons::reset();
+            Base::reset();
             relabel_queue.reserve(max_level);
 
-            while (!active.empty()) {
-                active.pop();
-            }
+            active.initialize(max_level);
             relabel_queue.clear();
             source_reachable_nodes.clear();
+            num_gaps = 0;
+        }
+
+        void importFlow(const FlowAssignment& fa, const std::vector<Node>& node_mapping, const std::vector<Hyperedge>& hyperedge_mapping) {
+            Base::importFlow(fa, node_mapping, hyperedge_mapping);
+            // saturateSourceEdges() expects the excess nodes at the front of source_reachable_nodes
+            source_reachable_nodes.clear();
+            for (int i = 0; i < max_level; ++i) {
+                Node u(i);
+                if (!isSource(u) && !isTarget(u) && excess[u] > 0) {
+                    level[u] = max_level;
+                    source_reachable_nodes.push_back(u);
+                }
+            }
         }
 
     private:
-        std::queue<Node> active;
+        Selection active;
         vec<Node> relabel_queue, source_reachable_nodes;
     };
 
+    using SequentialPushRelabel = BasicSequentialPushRelabel<>;
+    // 16-bit flow and level storage. only if CompactSequentialPushRelabel::fitsStorage(hg)
+    using CompactSequentialPushRelabel = BasicSequentialPushRelabel<int16_t, int16_t>;
+    // highest-label selection with gap heuristic instead of FIFO
+    using HighestLabelSequentialPushRelabel = BasicSequentialPushRelabel<Flow, int, HighestLabelSelection>;
+
 } // namespace whfc
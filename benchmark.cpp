@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <tbb/global_control.h>
+
+#include "algorithm/async_push_relabel.h"
+#include "algorithm/augmenting_path_flow.h"
+#include "algorithm/excess_scaling_push_relabel.h"
+#include "algorithm/hyperflowcutter.h"
+#include "algorithm/parallel_push_relabel.h"
+#include "algorithm/sequential_push_relabel.h"
+#include "io/binary_snapshot_io.h"
+#include "io/hmetis_io.h"
+#include "io/whfc_io.h"
+
+/*
+ * Runs HyperFlowCutter on a collection of snapshots (.hgr with .whfc side information, or binary snapshots) for several engines and thread
+ * counts, and writes one CSV row per run. With a baseline CSV from an earlier run, the median times per (graph, algorithm, threads) are
+ * compared, and the exit code is 1 if a configuration got slower than the tolerance allows or its flow changed.
+ * All runs are deterministic with a fixed seed, so that repetitions and baselines do the same work.
+ */
+namespace whfc {
+
+    struct BenchmarkConfig {
+        std::vector<std::string> inputs;
+        std::vector<size_t> threads = { 1 };
+        std::vector<std::string> engines = { "par" };
+        int repetitions = 3;
+        int seed = 0;
+        std::string output, baseline;
+        double tolerance = 0.1;         // allowed relative slowdown of the median time
+        double min_slowdown_time = 0.01; // slowdowns of at most this many seconds are noise
+        bool numa_aware = false;
+    };
+
+    struct BenchmarkResult {
+        std::string graph, algorithm;
+        size_t threads = 1;
+        int seed = 0, repetition = 0;
+        bool improved = false;
+        Flow flow = 0, flow_bound = 0;
+        size_t num_cuts = 0;
+        double time = 0.0, mbc_time = 0.0, discharge = 0.0, global_relabel = 0.0, update = 0.0, source_cut = 0.0, saturate = 0.0, assimilate = 0.0,
+               pierce = 0.0;
+    };
+
+    static const std::string csv_header = "graph,algorithm,seed,repetition,threads,improved,flow,flowbound,time,mbc_time,num_cuts,discharge,global relabel,"
+                                          "update,source cut,saturate,assimilate,pierce";
+
+    void writeCSVRow(std::ostream& os, const BenchmarkResult& r) {
+        os << r.graph << "," << r.algorithm << "," << r.seed << "," << r.repetition << "," << r.threads << "," << (r.improved ? "yes" : "no") << ","
+           << r.flow << "," << r.flow_bound << "," << r.time << "," << r.mbc_time << "," << r.num_cuts << "," << r.discharge << "," << r.global_relabel
+           << "," << r.update << "," << r.source_cut << "," << r.saturate << "," << r.assimilate << "," << r.pierce << std::endl;
+    }
+
+    struct Instance {
+        std::string name;
+        FlowHypergraphBuilder parsed;
+        FlowHypergraph mapped;
+        bool snapshot = false;
+        WHFC_IO::WHFCInformation info;
+
+        FlowHypergraph& hypergraph() { return snapshot ? mapped : parsed; }
+    };
+
+    void loadInstance(const std::string& filename, Instance& instance) {
+        instance.name = std::filesystem::path(filename).filename().string();
+        instance.snapshot = BinarySnapshotIO::isSnapshot(filename);
+        if (instance.snapshot) {
+            instance.mapped = BinarySnapshotIO::readSnapshot(filename);
+        } else {
+            HMetisIO::readFlowHypergraphWithBuilder(instance.parsed, filename);
+        }
+        if (!instance.snapshot || !BinarySnapshotIO::readAdditionalInformation(filename, instance.info)) {
+            instance.info = WHFC_IO::readAdditionalInformation(filename);
+        }
+        if (instance.info.s >= instance.hypergraph().numNodes() || instance.info.t >= instance.hypergraph().numNodes())
+            throw std::runtime_error("File: " + filename + " has s or t not within node id range");
+    }
+
+    template<typename FlowAlgorithm>
+    BenchmarkResult runHyperFlowCutter(Instance& instance, const std::string& algorithm, const BenchmarkConfig& config) {
+        FlowHypergraph& hg = instance.hypergraph();
+        HyperFlowCutter<FlowAlgorithm> hfc(hg, config.seed, /*deterministic=*/true);
+        hfc.cs.flow_algo.numa_aware = config.numa_aware;
+        hfc.setFlowBound(instance.info.upperFlowBound);
+        for (int i = 0; i < 2; ++i)
+            hfc.cs.setMaxBlockWeight(i, instance.info.maxBlockWeight[i]);
+
+        BenchmarkResult r;
+        Flow last_cut = 0;
+        auto on_cut = [&] {
+            if (hfc.cs.flow_algo.flow_value != last_cut) {
+                last_cut = hfc.cs.flow_algo.flow_value;
+                r.num_cuts++;
+            }
+            return true;
+        };
+
+        hfc.timer.start();
+        r.improved = hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(instance.info.s, instance.info.t, on_cut);
+        hfc.timer.stop();
+
+        auto& f = hfc.cs.flow_algo;
+        r.graph = instance.name;
+        r.algorithm = algorithm;
+        r.seed = config.seed;
+        r.flow = f.flow_value;
+        r.flow_bound = instance.info.upperFlowBound;
+        r.time = hfc.timer.get("HyperFlowCutter").count();
+        r.mbc_time = hfc.timer.get("MBMC").count();
+        r.discharge = f.discharge_time;
+        r.global_relabel = f.global_relabel_time;
+        r.update = f.update_time;
+        r.source_cut = f.source_cut_time;
+        r.saturate = f.saturate_time;
+        r.assimilate = hfc.assimilate_time;
+        r.pierce = hfc.pierce_time;
+        return r;
+    }
+
+    // engine keys on the command line and the algorithm names in the CSV, as in FlowTester
+    static const std::vector<std::pair<std::string, std::string>> engine_names = { { "seq", "SeqPR-FIFO" },           { "hl", "SeqPR-HL" },
+                                                                                   { "par", "ParPR-RL" },             { "async", "AsyncPR" },
+                                                                                   { "es", "SeqPR-ExcessScaling" }, { "ap", "AugmentingPaths" } };
+
+    BenchmarkResult runEngine(Instance& instance, const std::string& engine, const BenchmarkConfig& config) {
+        auto it = std::find_if(engine_names.begin(), engine_names.end(), [&](const auto& x) { return x.first == engine; });
+        if (it == engine_names.end())
+            throw std::runtime_error("Unknown engine " + engine);
+        const std::string& name = it->second;
+        if (engine == "seq")
+            return runHyperFlowCutter<SequentialPushRelabel>(instance, name, config);
+        if (engine == "hl")
+            return runHyperFlowCutter<HighestLabelSequentialPushRelabel>(instance, name, config);
+        if (engine == "par")
+            return runHyperFlowCutter<ParallelPushRelabel>(instance, name, config);
+        if (engine == "async")
+            return runHyperFlowCutter<AsyncPushRelabel>(instance, name, config);
+        if (engine == "es")
+            return runHyperFlowCutter<ExcessScalingPushRelabel>(instance, name, config);
+        return runHyperFlowCutter<AugmentingPathFlow>(instance, name, config);
+    }
+
+    // .hgr files and binary snapshots, in lexicographic order
+    std::vector<std::string> collectInputs(const std::vector<std::string>& paths) {
+        std::vector<std::string> files;
+        for (const std::string& p : paths) {
+            if (std::filesystem::is_directory(p)) {
+                std::vector<std::string> dir_files;
+                for (const auto& entry : std::filesystem::directory_iterator(p)) {
+                    const std::string f = entry.path().string();
+                    if (entry.is_regular_file() && (entry.path().extension() == ".hgr" || BinarySnapshotIO::isSnapshot(f))) {
+                        dir_files.push_back(f);
+                    }
+                }
+                std::sort(dir_files.begin(), dir_files.end());
+                files.insert(files.end(), dir_files.begin(), dir_files.end());
+            } else {
+                files.push_back(p);
+            }
+        }
+        return files;
+    }
+
+    using ConfigurationKey = std::tuple<std::string, std::string, size_t>; // graph, algorithm, threads
+
+    struct ConfigurationSummary {
+        std::vector<double> times;
+        Flow flow = 0;
+
+        double medianTime() {
+            std::sort(times.begin(), times.end());
+            const size_t n = times.size();
+            return n % 2 == 1 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+        }
+    };
+
+    std::vector<std::string> splitCSVLine(const std::string& line) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            fields.push_back(field);
+        }
+        return fields;
+    }
+
+    std::map<ConfigurationKey, ConfigurationSummary> readBaseline(const std::string& filename) {
+        std::ifstream f(filename);
+        if (!f)
+            throw std::runtime_error("File: " + filename + " not found.");
+        std::string line;
+        std::getline(f, line);
+        const std::vector<std::string> header = splitCSVLine(line);
+        auto column = [&](const std::string& name) {
+            auto it = std::find(header.begin(), header.end(), name);
+            if (it == header.end())
+                throw std::runtime_error("File: " + filename + " has no column " + name);
+            return size_t(it - header.begin());
+        };
+        const size_t graph = column("graph"), algorithm = column("algorithm"), threads = column("threads"), time = column("time"), flow = column("flow");
+        std::map<ConfigurationKey, ConfigurationSummary> baseline;
+        while (std::getline(f, line)) {
+            const std::vector<std::string> fields = splitCSVLine(line);
+            if (fields.size() != header.size())
+                continue;
+            ConfigurationSummary& s = baseline[{ fields[graph], fields[algorithm], std::stoul(fields[threads]) }];
+            s.times.push_back(std::stod(fields[time]));
+            s.flow = std::stoi(fields[flow]);
+        }
+        return baseline;
+    }
+
+    // returns the number of regressions
+    size_t compareAgainstBaseline(std::map<ConfigurationKey, ConfigurationSummary>& current, const BenchmarkConfig& config) {
+        std::map<ConfigurationKey, ConfigurationSummary> baseline = readBaseline(config.baseline);
+        size_t num_regressions = 0;
+        for (auto& [key, summary] : current) {
+            const auto& [graph, algorithm, threads] = key;
+            auto it = baseline.find(key);
+            if (it == baseline.end()) {
+                std::cerr << "no baseline for " << graph << " " << algorithm << " threads=" << threads << std::endl;
+                continue;
+            }
+            const double time = summary.medianTime(), baseline_time = it->second.medianTime();
+            const bool slower = time > baseline_time * (1.0 + config.tolerance) && time - baseline_time > config.min_slowdown_time;
+            const bool flow_changed = summary.flow != it->second.flow;
+            if (slower || flow_changed) {
+                num_regressions++;
+                std::cerr << "REGRESSION " << graph << " " << algorithm << " threads=" << threads << " median time " << time << "s vs baseline "
+                          << baseline_time << "s";
+                if (flow_changed)
+                    std::cerr << ", flow " << summary.flow << " vs baseline " << it->second.flow;
+                std::cerr << std::endl;
+            }
+        }
+        std::cerr << num_regressions << " regressions in " << current.size() << " configurations" << std::endl;
+        return num_regressions;
+    }
+
+    template<typename T>
+    std::vector<T> parseList(const std::string& s, T (*convert)(const std::string&)) {
+        std::vector<T> res;
+        std::stringstream ss(s);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            res.push_back(convert(item));
+        }
+        return res;
+    }
+
+    BenchmarkConfig parseArguments(int argc, const char* argv[]) {
+        BenchmarkConfig config;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--threads") {
+                config.threads = parseList<size_t>(value(), [](const std::string& x) { return size_t(std::stoul(x)); });
+            } else if (arg == "--engines") {
+                config.engines = parseList<std::string>(value(), [](const std::string& x) { return x; });
+            } else if (arg == "--repetitions") {
+                config.repetitions = std::stoi(value());
+            } else if (arg == "--seed") {
+                config.seed = std::stoi(value());
+            } else if (arg == "--output") {
+                config.output = value();
+            } else if (arg == "--baseline") {
+                config.baseline = value();
+            } else if (arg == "--tolerance") {
+                config.tolerance = std::stod(value());
+            } else if (arg == "--min-slowdown-time") {
+                config.min_slowdown_time = std::stod(value());
+            } else if (arg == "--numa") {
+                config.numa_aware = true;
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::runtime_error("Unknown option " + arg);
+            } else {
+                config.inputs.push_back(arg);
+            }
+        }
+        if (config.inputs.empty() || config.repetitions < 1)
+            throw std::runtime_error("Usage: ./Benchmark snapshot-directory-or-files... [--threads 1,2,4] [--engines seq,hl,par,async,es,ap] "
+                                     "[--repetitions 3] [--seed 0] [--output results.csv] [--baseline baseline.csv] [--tolerance 0.1] "
+                                     "[--min-slowdown-time 0.01] [--numa]");
+        return config;
+    }
+
+    int runBenchmark(const BenchmarkConfig& config) {
+        std::ofstream output_file;
+        if (!config.output.empty()) {
+            output_file.open(config.output);
+            if (!output_file)
+                throw std::runtime_error("Failed at creating benchmark output file " + config.output);
+        }
+        std::ostream& out = config.output.empty() ? std::cout : output_file;
+        out << csv_header << std::endl;
+
+        std::map<ConfigurationKey, ConfigurationSummary> summaries;
+        for (const std::string& filename : collectInputs(config.inputs)) {
+            Instance instance;
+            loadInstance(filename, instance);
+            for (size_t threads : config.threads) {
+                auto gc = tbb::global_control{ tbb::global_control::max_allowed_parallelism, threads };
+                for (const std::string& engine : config.engines) {
+                    for (int rep = 0; rep < config.repetitions; ++rep) {
+                        BenchmarkResult r = runEngine(instance, engine, config);
+                        r.threads = threads;
+                        r.repetition = rep;
+                        writeCSVRow(out, r);
+                        ConfigurationSummary& s = summaries[{ r.graph, r.algorithm, threads }];
+                        s.times.push_back(r.time);
+                        s.flow = r.flow;
+                    }
+                }
+            }
+        }
+
+        if (!config.baseline.empty() && compareAgainstBaseline(summaries, config) > 0) {
+            return 1;
+        }
+        return 0;
+    }
+
+} // namespace whfc
+
+int main(int argc, const char* argv[]) { return whfc::runBenchmark(whfc::parseArguments(argc, argv)); }
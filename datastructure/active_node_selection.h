@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <queue>
+#include <vector>
+
+#include "../definitions.h"
+
+namespace whfc {
+
+    // Selection policies for the active nodes of SequentialPushRelabel.
+    // Nodes are pushed with their current level. Policies with gap_heuristic = true additionally keep every node with a level in
+    // [1, max_level) in a bucket, so that the engine can detect levels that become empty on relabel.
+
+    class FIFOSelection {
+    public:
+        static constexpr bool gap_heuristic = false;
+
+        void initialize(size_t /* num_nodes */) { clear(); }
+        void clear() { queue = std::queue<Node>(); }
+        bool empty() const { return queue.empty(); }
+        size_t size() const { return queue.size(); }
+        void push(Node u, int /* level */) { queue.push(u); }
+        Node pop() {
+            const Node u = queue.front();
+            queue.pop();
+            return u;
+        }
+
+    private:
+        std::queue<Node> queue;
+    };
+
+    class HighestLabelSelection {
+    public:
+        static constexpr bool gap_heuristic = true;
+
+        // levels range in [0, num_nodes]
+        void initialize(size_t num_nodes) {
+            active_first.assign(num_nodes + 1, invalidNode);
+            active_next.resize(num_nodes);
+            bucket_first.assign(num_nodes + 1, invalidNode);
+            bucket_next.resize(num_nodes);
+            bucket_prev.resize(num_nodes);
+            num_active = 0;
+            highest_active = 0;
+            highest_bucket = 0;
+        }
+
+        /** active nodes */
+        void clear() {
+            for (int l = 0; l <= highest_active; ++l) {
+                active_first[l] = invalidNode;
+            }
+            num_active = 0;
+            highest_active = 0;
+        }
+        bool empty() const { return num_active == 0; }
+        size_t size() const { return num_active; }
+        void push(Node u, int level) {
+            active_next[u] = active_first[level];
+            active_first[level] = u;
+            highest_active = std::max(highest_active, level);
+            num_active++;
+        }
+        Node pop() {
+            assert(!empty());
+            while (active_first[highest_active] == invalidNode) {
+                highest_active--;
+            }
+            const Node u = active_first[highest_active];
+            active_first[highest_active] = active_next[u];
+            num_active--;
+            return u;
+        }
+
+        /** buckets of all nodes with a finite level */
+        void clearBuckets() {
+            for (int l = 0; l <= highest_bucket; ++l) {
+                bucket_first[l] = invalidNode;
+            }
+            highest_bucket = 0;
+        }
+        void addToBucket(Node u, int level) {
+            bucket_prev[u] = invalidNode;
+            bucket_next[u] = bucket_first[level];
+            if (bucket_first[level] != invalidNode) {
+                bucket_prev[bucket_first[level]] = u;
+            }
+            bucket_first[level] = u;
+            highest_bucket = std::max(highest_bucket, level);
+        }
+        void removeFromBucket(Node u, int level) {
+            if (bucket_prev[u] != invalidNode) {
+                bucket_next[bucket_prev[u]] = bucket_next[u];
+            } else {
+                assert(bucket_first[level] == u);
+                bucket_first[level] = bucket_next[u];
+            }
+            if (bucket_next[u] != invalidNode) {
+                bucket_prev[bucket_next[u]] = bucket_prev[u];
+            }
+        }
+        bool bucketEmpty(int level) const { return bucket_first[level] == invalidNode; }
+
+        // calls f for every node above level and removes them from the buckets. active nodes above level are dropped
+        template<typename F>
+        void removeAbove(int level, F&& f) {
+            for (int l = level + 1; l <= highest_bucket; ++l) {
+                for (Node u = bucket_first[l]; u != invalidNode; u = bucket_next[u]) {
+                    f(u);
+                }
+                bucket_first[l] = invalidNode;
+            }
+            highest_bucket = std::min(highest_bucket, level);
+            for (int l = level + 1; l <= highest_active; ++l) {
+                for (Node u = active_first[l]; u != invalidNode; u = active_next[u]) {
+                    num_active--;
+                }
+                active_first[l] = invalidNode;
+            }
+            highest_active = std::min(highest_active, level);
+        }
+
+    private:
+        std::vector<Node> active_first, active_next;
+        std::vector<Node> bucket_first, bucket_next, bucket_prev;
+        size_t num_active = 0;
+        int highest_active = 0, highest_bucket = 0;
+    };
+
+} // namespace whfc
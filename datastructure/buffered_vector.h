@@ -1,10 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/scalable_allocator.h>
 #include <vector>
 
+#include "../util/numa.h"
+
 namespace whfc {
 
     template<typename T>
@@ -32,10 +36,17 @@ namespace whfc {
 
         void adapt_capacity(size_t sz) {
             if (sz > data.size()) {
-                data.resize(sz, T());
+                if (interleaved) {
+                    interleavedResize(data, sz);
+                } else {
+                    data.resize(sz, T());
+                }
             }
         }
 
+        // spread the pages of data over all NUMA nodes when it grows
+        void set_interleaved(bool use) { interleaved = use; }
+
         void push_back_atomic(const T& element) {
             size_t pos = back.fetch_add(1, std::memory_order_relaxed);
             assert(pos < data.size());
@@ -52,7 +63,11 @@ namespace whfc {
 
         void swap_container(vec_t& o) {
             if (o.size() < data.size()) {
-                o.resize(data.size());
+                if (interleaved) {
+                    interleavedResize(o, data.size());
+                } else {
+                    o.resize(data.size());
+                }
             }
             std::swap(o, data);
         }
@@ -101,6 +116,7 @@ namespace whfc {
     private:
         vec_t data;
         std::atomic<size_t> back{ 0 };
+        bool interleaved = false;
         tbb::enumerable_thread_specific<vec_t> buffers;
         static constexpr size_t MAX_BUFFER_SIZE = 1024;
     };
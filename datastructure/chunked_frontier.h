@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <tbb/info.h>
+#include <tbb/scalable_allocator.h>
+#include <tbb/task_arena.h>
+#include <vector>
+
+#include "../util/numa.h"
+
+namespace whfc {
+
+    /*
+     * Frontier for parallel BFS layers and discharge rounds, with the interface of BufferedVector. Instead of thread-local buffers that
+     * finalize() copies over, each thread claims chunks of the output array with one atomic and writes into them directly.
+     * The state of the open chunks sits in one slot per arena thread, so finalize() only closes these slots and, if chunks were left
+     * partially filled, moves the elements from the back into the holes. Slots are indexed by tbb::this_task_arena::current_thread_index(),
+     * so all pushes between clear() and finalize() must come from one arena. Threads without a slot push one element at a time.
+     */
+    template<typename T>
+    class ChunkedFrontier {
+    public:
+        using vec_t = std::vector<T, tbb::scalable_allocator<T>>;
+        static constexpr size_t CHUNK_SIZE = 256;
+
+        ChunkedFrontier(size_t max_size) {
+            adaptSlots();
+            data.resize(max_size + slack(), T());
+            max_elements = max_size;
+        }
+
+        void clear() {
+            assert(std::all_of(slots.begin(), slots.end(), [](const Slot& s) { return s.fill == s.end; }));
+            back.store(0, std::memory_order_relaxed);
+            if (adaptSlots()) {
+                grow(max_elements);
+            }
+        }
+
+        size_t size() const { return back.load(std::memory_order_relaxed); }
+
+        bool empty() const { return size() == 0; }
+
+        size_t capacity() const { return max_elements; }
+
+        void adapt_capacity(size_t sz) {
+            adaptSlots();
+            if (sz > max_elements || sz + slack() > data.size()) {
+                grow(std::max(sz, max_elements));
+            }
+        }
+
+        // spread the pages of data over all NUMA nodes when it grows
+        void set_interleaved(bool use) { interleaved = use; }
+
+        void push_back_atomic(const T& element) {
+            size_t pos = back.fetch_add(1, std::memory_order_relaxed);
+            assert(pos < data.size());
+            data[pos] = element;
+        }
+
+        void push_back_buffered(const T& element) { local_buffer().push_back(element); }
+
+        // closes the open chunks. compacts only if some were left partially filled
+        void finalize() {
+            holes.clear();
+            for (Slot& s : slots) {
+                if (s.fill != s.end) {
+                    holes.push_back({ s.fill, s.end });
+                }
+                s.fill = s.end = 0;
+            }
+            if (holes.empty()) {
+                return;
+            }
+            std::sort(holes.begin(), holes.end(), [](const Hole& a, const Hole& b) { return a.begin < b.begin; });
+            const size_t end = size();
+            size_t hole_size = 0;
+            for (const Hole& h : holes) {
+                hole_size += h.end - h.begin;
+            }
+            const size_t new_size = end - hole_size;
+
+            // as many elements lie at or behind new_size as there are hole positions before it
+            size_t src = end;
+            size_t holes_before_src = holes.size();
+            auto next_element_from_back = [&] {
+                while (true) {
+                    --src;
+                    while (holes_before_src > 0 && holes[holes_before_src - 1].begin > src) {
+                        holes_before_src--;
+                    }
+                    if (holes_before_src > 0 && src < holes[holes_before_src - 1].end) {
+                        src = holes[holes_before_src - 1].begin;
+                        continue;
+                    }
+                    return src;
+                }
+            };
+            for (const Hole& h : holes) {
+                for (size_t pos = h.begin; pos < std::min(h.end, new_size); ++pos) {
+                    data[pos] = data[next_element_from_back()];
+                }
+            }
+            back.store(new_size, std::memory_order_relaxed);
+        }
+
+        void swap_container(vec_t& o) {
+            if (o.size() < data.size()) {
+                if (interleaved) {
+                    interleavedResize(o, data.size());
+                } else {
+                    o.resize(data.size());
+                }
+            }
+            std::swap(o, data);
+        }
+
+        void set_size(size_t s) { back.store(s, std::memory_order_relaxed); }
+
+        auto begin() { return data.begin(); }
+        auto end() { return data.begin() + size(); }
+        T& operator[](size_t pos) { return data[pos]; }
+        const T& operator[](size_t pos) const { return data[pos]; }
+
+        struct BufferHandle {
+            ChunkedFrontier* frontier;
+            size_t* fill;
+            size_t* end;
+
+            void push_back(const T& element) {
+                if (!fill) {
+                    frontier->push_back_atomic(element);
+                    return;
+                }
+                if (*fill == *end) {
+                    *fill = frontier->back.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+                    *end = *fill + CHUNK_SIZE;
+                    assert(*end <= frontier->data.size());
+                }
+                frontier->data[(*fill)++] = element;
+            }
+        };
+
+        BufferHandle local_buffer() {
+            const int slot = tbb::this_task_arena::current_thread_index();
+            if (slot < 0 || size_t(slot) >= slots.size()) {
+                return { this, nullptr, nullptr };
+            }
+            Slot& s = slots[slot];
+            return { this, &s.fill, &s.end };
+        }
+
+        struct RandomAccessRange {
+            size_t actual_size;
+            const vec_t& data_ref;
+            const T& operator[](size_t i) const { return data_ref[i]; }
+            size_t size() const { return actual_size; }
+        };
+        RandomAccessRange range() const { return { size(), data }; }
+
+        const vec_t& getData() const { return data; }
+
+    private:
+        struct alignas(64) Slot {
+            size_t fill = 0, end = 0;
+        };
+        struct Hole {
+            size_t begin, end;
+        };
+
+        // every slot can leave one partially filled chunk behind
+        size_t slack() const { return slots.size() * CHUNK_SIZE; }
+
+        // returns whether slots were added
+        bool adaptSlots() {
+            const size_t num_slots = size_t(std::max(tbb::this_task_arena::max_concurrency(), tbb::info::default_concurrency()));
+            if (num_slots <= slots.size()) {
+                return false;
+            }
+            slots.resize(num_slots);
+            return true;
+        }
+
+        void grow(size_t max_size) {
+            max_elements = max_size;
+            if (interleaved) {
+                interleavedResize(data, max_size + slack());
+            } else {
+                data.resize(max_size + slack(), T());
+            }
+        }
+
+        vec_t data;
+        size_t max_elements = 0;
+        std::atomic<size_t> back{ 0 };
+        std::vector<Slot> slots;
+        std::vector<Hole> holes;
+        bool interleaved = false;
+    };
+
+} // namespace whfc
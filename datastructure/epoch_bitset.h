@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+#include "../util/numa.h"
+
+namespace whfc {
+
+    /*
+     * Bitset over nodes that is cleared in constant time. Every 64-bit word holds 32 bits of the set in its lower half and, in its upper half,
+     * the epoch in which they were written. Bits of words from older epochs read as zero, so clear() only increments the epoch,
+     * and a membership test is a single load. A set costs 2 bits per node instead of a 32-bit stamp. The BFS of one side reads two sets,
+     * its terminals and its reached nodes, so it touches about 8 times fewer cache lines.
+     * The words are exposed so that their owner can resize them like its other node-indexed arrays.
+     */
+    class EpochBitset {
+    public:
+        static constexpr size_t bits_per_word = 32;
+        static size_t numWords(size_t n) { return (n + bits_per_word - 1) / bits_per_word; }
+
+        first_touch_vec<uint64_t> words; // zero-initialized words belong to no epoch
+
+        bool operator[](size_t i) const {
+            const uint64_t w = words[i / bits_per_word];
+            return (w >> bits_per_word) == epoch && ((w >> (i % bits_per_word)) & 1);
+        }
+
+        void clear() {
+            if (epoch == std::numeric_limits<uint32_t>::max()) {
+                std::fill(words.begin(), words.end(), 0);
+                epoch = 0;
+            }
+            ++epoch;
+        }
+
+        // not thread-safe, not even for different bits of the same word
+        void set(size_t i) {
+            uint64_t& w = words[i / bits_per_word];
+            w = current(w) | bit(i);
+        }
+        void reset(size_t i) {
+            uint64_t& w = words[i / bits_per_word];
+            w = current(w) & ~bit(i);
+        }
+
+        // returns whether the bit was newly set by this call
+        bool setAtomic(size_t i) {
+            uint64_t* p = &words[i / bits_per_word];
+            uint64_t w = __atomic_load_n(p, __ATOMIC_RELAXED);
+            while (true) {
+                const uint64_t cur = current(w);
+                if (cur & bit(i)) {
+                    return false;
+                }
+                if (__atomic_compare_exchange_n(p, &w, cur | bit(i), true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    return true;
+                }
+            }
+        }
+        void resetAtomic(size_t i) {
+            uint64_t* p = &words[i / bits_per_word];
+            uint64_t w = __atomic_load_n(p, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(p, &w, current(w) & ~bit(i), true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            }
+        }
+
+    private:
+        // the word with the bits of older epochs dropped
+        uint64_t current(uint64_t w) const { return (w >> bits_per_word) == epoch ? w : uint64_t(epoch) << bits_per_word; }
+        static uint64_t bit(size_t i) { return uint64_t(1) << (i % bits_per_word); }
+
+        uint32_t epoch = 1;
+    };
+
+} // namespace whfc
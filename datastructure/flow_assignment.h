@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "../definitions.h"
+
+namespace whfc {
+
+    /*
+     * Flow on the Lawler network of a FlowHypergraph, stored independently of the FlowHypergraph itself,
+     * so that it survives rebuilding the FlowHypergraph for the next flow problem.
+     * Pin flows of hyperedge e are stored in pin_flows[first_pin_flow[e]..first_pin_flow[e+1]), only if non-zero.
+     */
+    struct FlowAssignment {
+        struct PinFlow {
+            Node pin = invalidNode;
+            Flow in = 0; // flow from pin to the in-node of the hyperedge
+            Flow out = 0; // flow from the out-node of the hyperedge to pin
+        };
+
+        std::vector<Flow> bridge_flow;
+        std::vector<size_t> first_pin_flow;
+        std::vector<PinFlow> pin_flows;
+        Flow flow_value = 0;
+
+        size_t numHyperedges() const { return bridge_flow.size(); }
+
+        void clear() {
+            bridge_flow.clear();
+            first_pin_flow.assign(1, 0);
+            pin_flows.clear();
+            flow_value = 0;
+        }
+    };
+
+} // namespace whfc
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
 #include "../definitions.h"
+#include "../util/prefix_sum.h"
 #include "../util/unused.h"
+#include "mappable_vector.h"
 
 namespace whfc {
+    class BinarySnapshotIO;
 
     class FlowHypergraph {
     public:
@@ -28,10 +34,10 @@ namespace whfc {
             NodeWeight weight = NodeWeight(0);
         };
 
-        using PinRange = mutable_range<std::vector<Pin>>;
+        using PinRange = mutable_range<MappableVector<Pin>>;
         using PinIterator = PinRange::iterator;
         using PinIndexRange = mutable_index_range<PinIndex>;
-        using InHeRange = mutable_range<std::vector<InHe>>;
+        using InHeRange = mutable_range<MappableVector<InHe>>;
         using InHeIterator = InHeRange::iterator;
         using InHeIndexRange = mutable_index_range<InHeIndex>;
 
@@ -46,40 +52,59 @@ namespace whfc {
             nodes(maxNumNodes + 1), hyperedges(maxNumHyperedges + 1), pins(maxNumPins), incident_hyperedges(maxNumPins) {}
 
         FlowHypergraph(std::vector<NodeWeight>& node_weights, std::vector<HyperedgeWeight>& hyperedge_weights, std::vector<PinIndex>& hyperedge_sizes,
-                       std::vector<Node>& _pins) :
+                       std::vector<Node>& _pins, bool deterministic_incidence_order = true) :
             maxHyperedgeCapacity(0),
-            nodes(node_weights.size() + 1), hyperedges(hyperedge_weights.size() + 1), pins(_pins.size()), incident_hyperedges(_pins.size()),
-            total_node_weight(boost::accumulate(node_weights, NodeWeight(0))) {
-            size_t i = 0;
-            for (const Node p : _pins) {
-                pins[i++].pin = p; // copy pins
-                nodes[p + 1].first_out++; // bucket sizes
-            }
-
-            for (Node u : nodeIDs()) {
-                nodes[u + 1].first_out += nodes[u].first_out; // prefix sum
-                nodes[u].weight = node_weights[u]; // copy node weights
-            }
-
-            for (Hyperedge e : hyperedgeIDs()) {
-                hyperedges[e].capacity = hyperedge_weights[e];
-                hyperedges[e + 1].first_out = hyperedges[e].first_out + hyperedge_sizes[e]; // prefix sum
-                for (auto pin_it = beginIndexPins(e); pin_it != endIndexPins(e); pin_it++) {
-                    Pin& p = pins[pin_it];
-                    InHeIndex ind_he = nodes[p.pin].first_out++; // destroy first_out temporarily and reset later
-                    InHe& inc_he = incident_hyperedges[ind_he];
-                    inc_he.e = e;
-                    inc_he.pin_iter = pin_it; // set iterator for pin -> its position in the pins of the hyperedge
-                    p.he_inc_iter = ind_he; // set iterator for incident hyperedge -> its position in incident_hyperedges of the node
+            nodes(node_weights.size() + 1), hyperedges(hyperedge_weights.size() + 1), pins(_pins.size()), incident_hyperedges(_pins.size()) {
+            std::vector<uint32_t> degree(numNodes(), 0);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, numPins(), parallel_grain_size), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    pins[i].pin = _pins[i]; // copy pins
+                    __atomic_fetch_add(&degree[_pins[i]], 1, __ATOMIC_RELAXED); // bucket sizes
                 }
-                maxHyperedgeCapacity = std::max(maxHyperedgeCapacity, hyperedges[e].capacity);
-            }
-
-            for (Node u(numNodes() - 1); u > 0; u--)
-                nodes[u].first_out = nodes[u - 1].first_out; // reset temporarily destroyed first_out
-            nodes[0].first_out = InHeIndex(0);
+            });
+
+            total_node_weight = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, numNodes(), parallel_grain_size), NodeWeight(0),
+                    [&](const tbb::blocked_range<size_t>& r, NodeWeight sum) {
+                        for (size_t u = r.begin(); u < r.end(); ++u) {
+                            nodes[u].weight = node_weights[u]; // copy node weights
+                            sum += node_weights[u];
+                        }
+                        return sum;
+                    },
+                    std::plus<>());
+
+            const size_t num_pins = parallelPrefixSum<size_t>(
+                    numHyperedges(), [&](size_t e) { return size_t(hyperedge_sizes[e]); },
+                    [&](size_t e, size_t sum) {
+                        hyperedges[e].first_out = PinIndex::fromOtherValueType(sum);
+                        hyperedges[e].capacity = hyperedge_weights[e];
+                    },
+                    parallel_grain_size);
+            hyperedges[numHyperedges()].first_out = PinIndex::fromOtherValueType(num_pins);
+            assert(num_pins == numPins());
+            unused(num_pins);
+            maxHyperedgeCapacity = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, numHyperedges(), parallel_grain_size), Flow(0),
+                    [&](const tbb::blocked_range<size_t>& r, Flow max_capacity) {
+                        for (size_t e = r.begin(); e < r.end(); ++e) {
+                            max_capacity = std::max(max_capacity, hyperedges[e].capacity);
+                        }
+                        return max_capacity;
+                    },
+                    [](Flow a, Flow b) { return std::max(a, b); });
+
+            buildIncidenceArrays(degree, deterministic_incidence_order);
         }
 
+        // view of arrays that someone else owns, e.g., a memory-mapped snapshot. see io/binary_snapshot_io.h
+        FlowHypergraph(MappableVector<NodeData> nodes, MappableVector<HyperedgeData> hyperedges, MappableVector<Pin> pins,
+                       MappableVector<InHe> incident_hyperedges, NodeWeight total_node_weight, Flow max_hyperedge_capacity) :
+            maxHyperedgeCapacity(max_hyperedge_capacity),
+            nodes(std::move(nodes)), hyperedges(std::move(hyperedges)), pins(std::move(pins)), incident_hyperedges(std::move(incident_hyperedges)),
+            total_node_weight(total_node_weight) {
+            assert(this->nodes.size() >= 1 && this->hyperedges.size() >= 1 && this->pins.size() == this->incident_hyperedges.size());
+        }
 
         bool hasNodeWeights() const {
             return std::any_of(nodes.begin(), nodes.begin() + numNodes(), [](const NodeData& u) { return u.weight > 1; });
@@ -150,19 +175,67 @@ namespace whfc {
         Flow maxHyperedgeCapacity = maxFlow;
 
     protected:
-        std::vector<NodeData> nodes;
-        std::vector<HyperedgeData> hyperedges;
-        std::vector<Pin> pins;
-        std::vector<InHe> incident_hyperedges;
+        MappableVector<NodeData> nodes;
+        MappableVector<HyperedgeData> hyperedges;
+        MappableVector<Pin> pins;
+        MappableVector<InHe> incident_hyperedges;
 
         NodeWeight total_node_weight = NodeWeight(0);
 
+        static constexpr size_t parallel_grain_size = 1 << 12;
+
+        // Sets nodes[u].first_out from the degrees, and fills incident_hyperedges and the cross links with pins. Incident hyperedges
+        // claim their slots with atomic cursors, so their order is arbitrary. With deterministic = true, they are sorted by hyperedge
+        // afterwards, which is the order of a sequential build. node_degrees is used for the cursors. Like InHeIndex, the cursors have
+        // 32 bits, which suffices since they never exceed the number of pins.
+        void buildIncidenceArrays(std::vector<uint32_t>& node_degrees, bool deterministic) {
+            assert(numPins() < InHeIndex::InvalidValue);
+            const size_t n = numNodes();
+            const size_t num_incidences = parallelPrefixSum<size_t>(
+                    n, [&](size_t u) { return size_t(node_degrees[u]); },
+                    [&](size_t u, size_t sum) {
+                        node_degrees[u] = sum;
+                        nodes[u].first_out = InHeIndex::fromOtherValueType(sum);
+                    },
+                    parallel_grain_size);
+            nodes[n].first_out = InHeIndex::fromOtherValueType(num_incidences);
+            assert(num_incidences == numPins());
+            unused(num_incidences);
+
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, numHyperedges(), parallel_grain_size / 8), [&](const tbb::blocked_range<size_t>& r) {
+                for (Hyperedge e(r.begin()); e < r.end(); ++e) {
+                    for (const PinIndex pin_it : pinIndices(e)) {
+                        Pin& p = pins[pin_it];
+                        const InHeIndex ind_he(__atomic_fetch_add(&node_degrees[p.pin], 1, __ATOMIC_RELAXED));
+                        incident_hyperedges[ind_he] = { e, pin_it }; // set iterator for pin -> its position in the pins of the hyperedge
+                        p.he_inc_iter = ind_he; // set iterator for incident hyperedge -> its position in incident_hyperedges of the node
+                    }
+                }
+            });
+
+            if (deterministic) {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, n, parallel_grain_size / 8), [&](const tbb::blocked_range<size_t>& r) {
+                    for (Node u(r.begin()); u < r.end(); ++u) {
+                        if (degree(u) > 1) {
+                            std::sort(beginHyperedges(u), endHyperedges(u),
+                                      [](const InHe& a, const InHe& b) { return a.e < b.e || (a.e == b.e && a.pin_iter < b.pin_iter); });
+                            for (const InHeIndex i : incidentHyperedgeIndices(u)) {
+                                pins[incident_hyperedges[i].pin_iter].he_inc_iter = i;
+                            }
+                        }
+                    }
+                });
+            }
+        }
+
         static_assert(std::is_trivially_destructible<Pin>::value);
         static_assert(std::is_trivially_destructible<InHe>::value);
         static_assert(std::is_trivially_destructible<HyperedgeData>::value);
         static_assert(std::is_trivially_destructible<NodeData>::value);
         static_assert(std::is_trivially_destructible<PinIndexRange>::value);
 
+        friend class BinarySnapshotIO;
+
     public:
         void printNodes(std::ostream& out) {
             out << "---Nodes---\n";
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <type_traits>
 #include "flow_hypergraph.h"
 
 /*
@@ -56,40 +57,113 @@ namespace whfc {
         void addPin(const Node u) {
             assert(u < numNodes());
             pins.push_back({ u, InHeIndex::Invalid() });
-            nodes[u + 1].first_out++;
         }
 
         size_t currentHyperedgeSize() const { return numPins() - numPinsAtHyperedgeStart; }
 
+        /** bulk interface */
+        // Appends num_hyperedges hyperedges with one allocation per array, in parallel. size(i) is the number of pins of the i-th hyperedge,
+        // capacity(i) its capacity, and generate_pins(i, emit) calls emit(Node) for each of its pins. Hyperedges with zero/one pins are skipped.
+        // All three are called concurrently for different i. Can be mixed with startHyperedge / addPin.
+        template<typename SizeFunc, typename CapacityFunc, typename PinGenerator>
+        void appendHyperedges(size_t num_hyperedges, SizeFunc&& size, CapacityFunc&& capacity, PinGenerator&& generate_pins) {
+            finishHyperedge();
+            numPinsAtHyperedgeStart = numPins();
+
+            // sizes of the kept hyperedges, then prefix sums give their positions and the positions of their pins
+            std::vector<size_t> kept_size(num_hyperedges), pin_offset(num_hyperedges);
+            std::vector<Index> position(num_hyperedges);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, num_hyperedges, parallel_grain_size), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    const size_t sz = size(i);
+                    kept_size[i] = sz > 1 ? sz : 0;
+                }
+            });
+            const size_t num_new_pins = parallelPrefixSum<size_t>(
+                    num_hyperedges, [&](size_t i) { return kept_size[i]; }, [&](size_t i, size_t sum) { pin_offset[i] = sum; }, parallel_grain_size);
+            const size_t num_new_hyperedges = parallelPrefixSum<Index>(
+                    num_hyperedges, [&](size_t i) { return Index(kept_size[i] > 0); },
+                    [&](size_t i, Index sum) { position[i] = kept_size[i] > 0 ? sum : invalidIndex; }, parallel_grain_size);
+            const size_t first_pin = numPins(), first_hyperedge = numHyperedges();
+            pins.resize(first_pin + num_new_pins);
+            hyperedges.resize(hyperedges.size() + num_new_hyperedges); // the old sentinel becomes the first appended hyperedge
+
+            maxHyperedgeCapacity = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, num_hyperedges, parallel_grain_size / 8), maxHyperedgeCapacity,
+                    [&](const tbb::blocked_range<size_t>& r, Flow max_capacity) {
+                        for (size_t i = r.begin(); i < r.end(); ++i) {
+                            if (position[i] == invalidIndex) {
+                                continue;
+                            }
+                            const Flow c = capacity(i);
+                            const size_t pos = first_pin + pin_offset[i];
+                            hyperedges[first_hyperedge + position[i]] = { PinIndex::fromOtherValueType(pos), c };
+                            size_t j = pos;
+                            generate_pins(i, [&](const Node u) {
+                                assert(u < numNodes());
+                                pins[j++] = { u, InHeIndex::Invalid() };
+                            });
+                            assert(j == pos + kept_size[i]);
+                            max_capacity = std::max(max_capacity, c);
+                        }
+                        return max_capacity;
+                    },
+                    [](Flow a, Flow b) { return std::max(a, b); });
+
+            hyperedges.back() = { PinIndex::fromOtherValueType(numPins()), Flow(0) }; // sentinel
+            numPinsAtHyperedgeStart = numPins();
+        }
+
+        // Appends the hyperedges of a CSR representation: the pins of the i-th hyperedge are pin_ids[offsets[i]], ..., pin_ids[offsets[i + 1] - 1].
+        // capacities may be nullptr for unit capacities. Takes anything indexable, e.g., pointers or vectors
+        template<typename Offsets, typename PinIDs, typename Capacities>
+        void appendHyperedgesFromCSR(size_t num_hyperedges, const Offsets& offsets, const PinIDs& pin_ids, const Capacities& capacities) {
+            appendHyperedges(
+                    num_hyperedges, [&](size_t i) { return size_t(offsets[i + 1] - offsets[i]); },
+                    [&](size_t i) {
+                        if constexpr (std::is_same_v<Capacities, std::nullptr_t>) {
+                            unused(i);
+                            return Flow(1);
+                        } else {
+                            return Flow(capacities[i]);
+                        }
+                    },
+                    [&](size_t i, auto&& emit) {
+                        for (auto j = offsets[i]; j < offsets[i + 1]; ++j) {
+                            emit(Node(pin_ids[j]));
+                        }
+                    });
+        }
+
         void removeCurrentHyperedge() {
             while (numPins() > numPinsAtHyperedgeStart)
                 removeLastPin();
         }
 
-        void finalize() {
+        // deterministic = false leaves the incident hyperedges of each node in arbitrary order, which saves sorting them
+        void finalize(bool deterministic = true) {
             if (!finishHyperedge()) // finish last open hyperedge
                 hyperedges.back().capacity = 0; // maybe the last started hyperedge has zero/one pins and thus we still use the previous sentinel. was never a
                                                 // bug, since that capacity is never read
 
-            total_node_weight = NodeWeight(0);
-            for (Node u : nodeIDs()) {
-                nodes[u + 1].first_out += nodes[u].first_out;
-                total_node_weight += nodes[u].weight;
-            }
-
-            incident_hyperedges.resize(numPins());
-            for (Hyperedge e : hyperedgeIDs()) {
-                for (auto pin_it = beginIndexPins(e); pin_it != endIndexPins(e); pin_it++) {
-                    Pin& p = pins[pin_it];
-                    InHeIndex ind_he = nodes[p.pin].first_out++; // destroy first_out temporarily and reset later
-                    incident_hyperedges[ind_he] = { e, pin_it };
-                    p.he_inc_iter = ind_he; // set iterator for incident hyperedge -> its position in incident_hyperedges of the node
+            std::vector<uint32_t> degree(numNodes(), 0);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, numPins(), parallel_grain_size), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    __atomic_fetch_add(&degree[pins[i].pin], 1, __ATOMIC_RELAXED);
                 }
-            }
+            });
+            total_node_weight = tbb::parallel_reduce(
+                    tbb::blocked_range<size_t>(0, numNodes(), parallel_grain_size), NodeWeight(0),
+                    [&](const tbb::blocked_range<size_t>& r, NodeWeight sum) {
+                        for (size_t u = r.begin(); u < r.end(); ++u) {
+                            sum += nodes[u].weight;
+                        }
+                        return sum;
+                    },
+                    std::plus<>());
 
-            for (Node u(numNodes() - 1); u > 0; u--)
-                nodes[u].first_out = nodes[u - 1].first_out; // reset temporarily destroyed first_out
-            nodes[0].first_out = InHeIndex(0);
+            incident_hyperedges.resize(numPins());
+            buildIncidenceArrays(degree, deterministic);
 
             finalized = true;
         }
@@ -102,10 +176,7 @@ namespace whfc {
         }
 
     private:
-        void removeLastPin() {
-            nodes[pins.back().pin + 1].first_out--;
-            pins.pop_back();
-        }
+        void removeLastPin() { pins.pop_back(); }
 
         bool finishHyperedge() {
             if (currentHyperedgeSize() == 1) {
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace whfc {
+
+    // Vector that either owns its elements or is a view of memory owned by someone else, e.g., a memory-mapped snapshot file.
+    // Views cannot change their size, the size-changing members throw on them. The owner of their memory is kept alive by holder.
+    template<typename T>
+    class MappableVector {
+    public:
+        using value_type = T;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reference = T&;
+        using const_reference = const T&;
+
+        MappableVector() = default;
+        explicit MappableVector(size_t n) : owned(n) { sync(); }
+        MappableVector(T* data, size_t n, std::shared_ptr<const void> holder) : _data(data), _size(n), holder(std::move(holder)), view(true) {}
+
+        MappableVector(const MappableVector& o) : owned(o.owned), _data(o._data), _size(o._size), holder(o.holder), view(o.view) {
+            if (!view) {
+                sync();
+            }
+        }
+        MappableVector(MappableVector&& o) noexcept { swap(o); }
+        MappableVector& operator=(MappableVector o) noexcept {
+            swap(o);
+            return *this;
+        }
+
+        void swap(MappableVector& o) noexcept {
+            std::swap(owned, o.owned); // keeps the element addresses
+            std::swap(_data, o._data);
+            std::swap(_size, o._size);
+            std::swap(holder, o.holder);
+            std::swap(view, o.view);
+        }
+
+        bool isView() const { return view; }
+
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        T* data() { return _data; }
+        const T* data() const { return _data; }
+        iterator begin() { return _data; }
+        iterator end() { return _data + _size; }
+        const_iterator begin() const { return _data; }
+        const_iterator end() const { return _data + _size; }
+        const_iterator cbegin() const { return _data; }
+        const_iterator cend() const { return _data + _size; }
+        T& operator[](size_t i) {
+            assert(i < _size);
+            return _data[i];
+        }
+        const T& operator[](size_t i) const {
+            assert(i < _size);
+            return _data[i];
+        }
+        T& back() { return (*this)[_size - 1]; }
+        const T& back() const { return (*this)[_size - 1]; }
+
+        /** only for owning vectors */
+        void push_back(const T& x) {
+            requireOwned("push_back");
+            owned.push_back(x);
+            sync();
+        }
+        void pop_back() {
+            requireOwned("pop_back");
+            owned.pop_back();
+            sync();
+        }
+        void resize(size_t n) {
+            requireOwned("resize");
+            owned.resize(n);
+            sync();
+        }
+        void clear() {
+            requireOwned("clear");
+            owned.clear();
+            sync();
+        }
+        void shrink_to_fit() {
+            requireOwned("shrink_to_fit");
+            owned.shrink_to_fit();
+            sync();
+        }
+
+    private:
+        std::vector<T> owned;
+        T* _data = nullptr;
+        size_t _size = 0;
+        std::shared_ptr<const void> holder;
+        bool view = false;
+
+        void requireOwned(const char* operation) const {
+            if (view)
+                throw std::runtime_error(std::string("MappableVector::") + operation + " on a view");
+        }
+
+        void sync() {
+            _data = owned.data();
+            _size = owned.size();
+        }
+    };
+
+} // namespace whfc
@@ -1,107 +1,172 @@
 #include <iostream>
+#include "io/binary_snapshot_io.h"
 #include "io/hmetis_io.h"
 #include "io/whfc_io.h"
 
 #include <tbb/global_control.h>
 #include "util/tbb_thread_pinning.h"
 
+#include "algorithm/async_push_relabel.h"
+#include "algorithm/augmenting_path_flow.h"
+#include "algorithm/excess_scaling_push_relabel.h"
 #include "algorithm/parallel_push_relabel.h"
 #include "algorithm/parallel_push_relabel_block.h"
 #include "algorithm/sequential_push_relabel.h"
 
 namespace whfc {
-    void pin() {
-        int slot = 0;
-        cpu_set_t target_mask;
-        CPU_ZERO(&target_mask);
-        CPU_SET(slot, &target_mask);
-        size_t size = CPU_ALLOC_SIZE(std::thread::hardware_concurrency());
-        int err = sched_setaffinity(0, size, &target_mask);
-        if (err) {
-            std::cout << "couldnt set thread affinity" << std::endl;
-            std::exit(1);
-        }
-    }
+    template<typename FlowAlgorithm>
+    void runFlowAlgorithm(FlowHypergraph& hg, Node s, Node t, const std::string& base_filename, const std::string& algo_name, int seed, int threads) {
+        TimeReporter timer;
+        FlowAlgorithm pr(hg);
+        timer.start(algo_name);
+        pr.computeMaxFlow(s, t);
+        timer.stop(algo_name);
 
-    void unpin() {
-        cpu_set_t target_mask;
-        CPU_ZERO(&target_mask);
-        for (size_t core = 0; core < std::thread::hardware_concurrency(); ++core) {
-            CPU_SET(core, &target_mask);
-        }
-        size_t size = CPU_ALLOC_SIZE(std::thread::hardware_concurrency());
-        int err = sched_setaffinity(0, size, &target_mask);
-        if (err) {
-            std::cout << "couldnt reset thread affinity" << std::endl;
-            std::exit(1);
-        }
+        /*
+         * header
+         * graph,algorithm,seed,threads,time,discharge,global relabel,update,saturate,sequential
+         */
+        std::cout << base_filename << "," << algo_name << ",";
+        std::cout << seed << ",";
+        std::cout << threads << ",";
+        std::cout << timer.get(algo_name).count();
+        std::cout << "," << pr.discharge_time << "," << pr.global_relabel_time << "," << pr.update_time << "," << pr.saturate_time << "," << pr.sequential_time;
+        std::cout << std::endl;
+        // per-phase counters as JSON lines, so that stdout stays CSV
+        pr.instrumentation.writeJSON(std::cerr, base_filename + "," + algo_name + "," + std::to_string(seed));
     }
 
-
     void runSnapshotTester(const std::string& filename, int max_num_threads) {
         static constexpr bool log = false;
-        pin();
-        WHFC_IO::WHFCInformation info = WHFC_IO::readAdditionalInformation(filename);
+        // binary snapshots are mapped, .hgr files are parsed
+        const bool snapshot = BinarySnapshotIO::isSnapshot(filename);
+        WHFC_IO::WHFCInformation info;
+        if (!snapshot || !BinarySnapshotIO::readAdditionalInformation(filename, info)) {
+            info = WHFC_IO::readAdditionalInformation(filename);
+        }
         Node s = info.s;
         Node t = info.t;
         LOGGER << "(s,t,max f) =" << s << t << info.upperFlowBound;
 
-        FlowHypergraphBuilder hg;
-        HMetisIO::readFlowHypergraphWithBuilder(hg, filename);
+        FlowHypergraphBuilder hgb;
+        FlowHypergraph mapped;
+        if (snapshot) {
+            mapped = BinarySnapshotIO::readSnapshot(filename);
+        } else {
+            HMetisIO::readFlowHypergraphWithBuilder(hgb, filename);
+        }
+        FlowHypergraph& hg = snapshot ? mapped : hgb;
         LOGGER << "(n,m,p) =" << hg.numNodes() << hg.numHyperedges() << hg.numPins();
         if (s >= hg.numNodes() || t >= hg.numNodes())
             throw std::runtime_error("s or t not within node id range");
 
         std::string base_filename = filename.substr(filename.find_last_of("/\\") + 1);
-        unpin();
 
         for (int threads = 32; threads <= 32; threads *= 2) {
             auto gc = tbb::global_control{ tbb::global_control::max_allowed_parallelism, threads };
-            whfc::pinning_observer thread_pinner;
-            thread_pinner.observe(true);
-            for (int i = 0; i < 1; ++i) {
-                TimeReporter timer;
-                ParallelPushRelabel pr(hg);
-                timer.start("ParPR-RL");
-                Flow f_pr = pr.computeMaxFlow(s, t);
-                timer.stop("ParPR-RL");
-                // std::cout << base_filename << "," << i << ",ParPR-RL," << threads << "," << timer.get("ParPR-RL").count() << std::endl;
-
-                /*
-                 * header
-                 * graph,algorithm,seed,threads,time,discharge,global relabel,update,saturate
-                 */
-                std::cout << base_filename << ",ParPR-RL,";
-                std::cout << i << ",";
-                std::cout << threads << ",";
-                std::cout << timer.get("ParPR-RL").count();
-                std::cout << "," << pr.discharge_time << "," << pr.global_relabel_time << "," << pr.update_time << "," << pr.saturate_time;
-                std::cout << std::endl;
-
-                /*
-                ParallelPushRelabelBlock prb(hg);
-                timer.start("ParPR-Block");
-                Flow f_pr_block = pr.computeMaxFlow(s, t);
-                timer.stop("ParPR-Block");
-                std::cout << base_filename << "," << i << ",ParPR-Block," << threads << "," << timer.get("ParPR-Block").count() << std::endl;
-
-                if (f_pr != f_pr_block) {
-                    std::cout << "flow not equal " << base_filename << " " << V(f_pr) << " " << V(f_pr_block) << std::endl;
+            PinnedArena arena(CpuTopology::read(), PinningPolicy::Compact, size_t(threads));
+            // the arena is capped by the allowed CPUs, so report its size instead of the requested number
+            const int arena_threads = arena.taskArena().max_concurrency();
+            arena.execute([&] {
+                for (int i = 0; i < 1; ++i) {
+                    runFlowAlgorithm<ParallelPushRelabel>(hg, s, t, base_filename, "ParPR-RL", i, arena_threads);
+                    // additionally with narrower flow and level storage when the snapshot allows it
+                    if (CompactParallelPushRelabel::fitsStorage(hg)) {
+                        runFlowAlgorithm<CompactParallelPushRelabel>(hg, s, t, base_filename, "ParPR-RL-16", i, arena_threads);
+                    }
+                    runFlowAlgorithm<AsyncPushRelabel>(hg, s, t, base_filename, "AsyncPR", i, arena_threads);
+                    // sequential selection policies
+                    runFlowAlgorithm<SequentialPushRelabel>(hg, s, t, base_filename, "SeqPR-FIFO", i, arena_threads);
+                    runFlowAlgorithm<HighestLabelSequentialPushRelabel>(hg, s, t, base_filename, "SeqPR-HL", i, arena_threads);
+                    runFlowAlgorithm<ExcessScalingPushRelabel>(hg, s, t, base_filename, "SeqPR-ExcessScaling", i, arena_threads);
+                    runFlowAlgorithm<AugmentingPathFlow>(hg, s, t, base_filename, "AugmentingPaths", i, arena_threads);
+
+                    /*
+                    ParallelPushRelabelBlock prb(hg);
+                    timer.start("ParPR-Block");
+                    Flow f_pr_block = pr.computeMaxFlow(s, t);
+                    timer.stop("ParPR-Block");
+                    std::cout << base_filename << "," << i << ",ParPR-Block," << threads << "," << timer.get("ParPR-Block").count() << std::endl;
+
+                    if (f_pr != f_pr_block) {
+                        std::cout << "flow not equal " << base_filename << " " << V(f_pr) << " " << V(f_pr_block) << std::endl;
+                    }
+                     */
                 }
-                 */
+            });
+        }
+    }
+
+    struct ResetBenchmarkInput {
+        std::string filename, base_filename;
+        WHFC_IO::WHFCInformation info;
+    };
+
+    inline ResetBenchmarkInput readResetBenchmarkInput(FlowHypergraphBuilder& hg, const std::string& filename) {
+        ResetBenchmarkInput in{ filename, filename.substr(filename.find_last_of("/\\") + 1), WHFC_IO::readAdditionalInformation(filename) };
+        HMetisIO::readFlowHypergraphWithBuilder(hg, filename);
+        if (in.info.s >= hg.numNodes() || in.info.t >= hg.numNodes())
+            throw std::runtime_error("s or t not within node id range");
+        return in;
+    }
+
+    template<typename FlowAlgorithm>
+    void runResetBenchmark(const std::string& filename, const std::string& large_filename, const std::string& algo_name, int repetitions) {
+        // per-call overhead of reset() when the flow algorithm is reused for many small flow problems.
+        // with a large instance, the algorithm first solves that one, so that the small runs happen inside buffers sized for the large one
+        for (bool sparse_reset : { false, true }) {
+            FlowHypergraphBuilder hg;
+            FlowAlgorithm fa(hg);
+            fa.sparse_reset = sparse_reset;
+            std::string warmup = "-";
+            if (!large_filename.empty()) {
+                const ResetBenchmarkInput large = readResetBenchmarkInput(hg, large_filename);
+                fa.reset();
+                fa.initialize(large.info.s, large.info.t);
+                fa.findMinCuts();
+                warmup = large.base_filename;
             }
+            const ResetBenchmarkInput in = readResetBenchmarkInput(hg, filename);
+            double reset_time = 0.0, total_time = 0.0;
+            for (int i = 0; i < repetitions; ++i) {
+                auto t0 = tbb::tick_count::now();
+                fa.reset();
+                auto t1 = tbb::tick_count::now();
+                fa.initialize(in.info.s, in.info.t);
+                fa.findMinCuts();
+                auto t2 = tbb::tick_count::now();
+                reset_time += (t1 - t0).seconds();
+                total_time += (t2 - t0).seconds();
+            }
+            /*
+             * header
+             * graph,warmed up on,algorithm,sparse reset,repetitions,avg reset time,avg total time
+             */
+            std::cout << in.base_filename << "," << warmup << "," << algo_name << "," << sparse_reset << "," << repetitions << ",";
+            std::cout << reset_time / repetitions << "," << total_time / repetitions << std::endl;
         }
     }
 
+    void runResetBenchmark(const std::string& filename, const std::string& large_filename, int threads) {
+        auto gc = tbb::global_control{ tbb::global_control::max_allowed_parallelism, size_t(threads) };
+        const int repetitions = 100;
+        runResetBenchmark<SequentialPushRelabel>(filename, large_filename, "SeqPR", repetitions);
+        runResetBenchmark<ParallelPushRelabel>(filename, large_filename, "ParPR-RL", repetitions);
+    }
+
 } // namespace whfc
 
 int main(int argc, const char* argv[]) {
-    if (argc > 3 || argc < 2)
-        throw std::runtime_error("Usage: ./FlowTester hypergraphfile #threads");
+    if (argc > 5 || argc < 2)
+        throw std::runtime_error("Usage: ./FlowTester hypergraphfile #threads [reset [large hypergraphfile]]");
     std::string hgfile = argv[1];
     int threads = 1;
-    if (argc == 3)
+    if (argc >= 3)
         threads = std::stoi(argv[2]);
+    if (argc >= 4 && std::string(argv[3]) == "reset") {
+        whfc::runResetBenchmark(hgfile, argc == 5 ? argv[4] : "", threads);
+        return 0;
+    }
     /*
     tbb::task_scheduler_init tsi(threads);
     whfc::pinning_observer thread_pinner;
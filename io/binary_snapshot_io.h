@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+#include "../datastructure/flow_hypergraph.h"
+#include "whfc_io.h"
+
+namespace whfc {
+
+    /*
+     * Binary snapshot of a FlowHypergraph and its .whfc side information. The four arrays are stored exactly as laid out in FlowHypergraph,
+     * including the sentinels of nodes and hyperedges, so that readSnapshot can map the file and hand out a FlowHypergraph view without
+     * parsing or copying. The mapping is private: writes to the hypergraph are possible but do not reach the file.
+     * The format is native-endian and checks the byte order and the element sizes on load.
+     */
+    class BinarySnapshotIO {
+    public:
+        static constexpr char magic[8] = { 'W', 'H', 'F', 'C', 'S', 'N', 'A', 'P' };
+        static constexpr uint32_t version = 1;
+        static constexpr uint32_t byte_order_mark = 0x01020304;
+        static constexpr size_t alignment = 64;
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t byte_order_mark;
+            uint32_t element_sizes[4];
+            uint64_t num_nodes, num_hyperedges, num_pins;
+            uint64_t total_node_weight;
+            int64_t max_hyperedge_capacity;
+            uint64_t nodes_offset, hyperedges_offset, pins_offset, incident_hyperedges_offset, file_size;
+            // .whfc side information
+            uint32_t has_information;
+            NodeWeight max_block_weight[2];
+            Flow upper_flow_bound;
+            uint32_t s, t;
+        };
+
+        static bool isSnapshot(const std::string& filename) {
+            std::ifstream f(filename, std::ios::binary);
+            char m[sizeof(magic)];
+            return f.read(m, sizeof(m)) && std::memcmp(m, magic, sizeof(magic)) == 0;
+        }
+
+        static void writeSnapshot(const FlowHypergraph& hg, const WHFC_IO::WHFCInformation* info, const std::string& filename) {
+            std::ofstream f(filename, std::ios::binary);
+            if (!f)
+                throw std::runtime_error("Failed at creating snapshot file " + filename);
+
+            Header h;
+            std::memset(&h, 0, sizeof(Header));
+            std::memcpy(h.magic, magic, sizeof(magic));
+            h.version = version;
+            h.byte_order_mark = byte_order_mark;
+            setElementSizes(h.element_sizes);
+            h.num_nodes = hg.numNodes();
+            h.num_hyperedges = hg.numHyperedges();
+            h.num_pins = hg.numPins();
+            h.total_node_weight = hg.totalNodeWeight();
+            h.max_hyperedge_capacity = hg.maxHyperedgeCapacity;
+            h.nodes_offset = align(sizeof(Header));
+            h.hyperedges_offset = align(h.nodes_offset + hg.nodes.size() * sizeof(FlowHypergraph::NodeData));
+            h.pins_offset = align(h.hyperedges_offset + hg.hyperedges.size() * sizeof(FlowHypergraph::HyperedgeData));
+            h.incident_hyperedges_offset = align(h.pins_offset + hg.pins.size() * sizeof(FlowHypergraph::Pin));
+            h.file_size = h.incident_hyperedges_offset + hg.incident_hyperedges.size() * sizeof(FlowHypergraph::InHe);
+            if (info) {
+                h.has_information = 1;
+                h.max_block_weight[0] = info->maxBlockWeight[0];
+                h.max_block_weight[1] = info->maxBlockWeight[1];
+                h.upper_flow_bound = info->upperFlowBound;
+                h.s = info->s;
+                h.t = info->t;
+            }
+
+            size_t pos = 0;
+            auto write = [&](const void* data, size_t bytes, size_t offset) {
+                static const char zeros[alignment] = {};
+                f.write(zeros, offset - pos);
+                f.write(reinterpret_cast<const char*>(data), bytes);
+                pos = offset + bytes;
+            };
+            write(&h, sizeof(Header), 0);
+            write(hg.nodes.data(), hg.nodes.size() * sizeof(FlowHypergraph::NodeData), h.nodes_offset);
+            write(hg.hyperedges.data(), hg.hyperedges.size() * sizeof(FlowHypergraph::HyperedgeData), h.hyperedges_offset);
+            write(hg.pins.data(), hg.pins.size() * sizeof(FlowHypergraph::Pin), h.pins_offset);
+            write(hg.incident_hyperedges.data(), hg.incident_hyperedges.size() * sizeof(FlowHypergraph::InHe), h.incident_hyperedges_offset);
+            f.close();
+            if (!f)
+                throw std::runtime_error("Failed at writing snapshot file " + filename);
+        }
+
+        // maps the file read-only and returns a view on it. the hypergraph is never written after construction
+        static FlowHypergraph readSnapshot(const std::string& filename) {
+            const int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("File: " + filename + " not found.");
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header)) {
+                ::close(fd);
+                throw std::runtime_error("File: " + filename + " is too small for a snapshot.");
+            }
+            const size_t length = st.st_size;
+            void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd); // the mapping stays valid
+            if (addr == MAP_FAILED)
+                throw std::runtime_error("File: " + filename + " could not be mapped.");
+            std::shared_ptr<const void> holder(addr, [length](const void* p) { ::munmap(const_cast<void*>(p), length); });
+
+            char* base = static_cast<char*>(addr);
+            const Header& h = *reinterpret_cast<const Header*>(base);
+            checkHeader(h, length, filename);
+            return FlowHypergraph(mapArray<FlowHypergraph::NodeData>(base, h.nodes_offset, h.num_nodes + 1, holder),
+                                  mapArray<FlowHypergraph::HyperedgeData>(base, h.hyperedges_offset, h.num_hyperedges + 1, holder),
+                                  mapArray<FlowHypergraph::Pin>(base, h.pins_offset, h.num_pins, holder),
+                                  mapArray<FlowHypergraph::InHe>(base, h.incident_hyperedges_offset, h.num_pins, holder), NodeWeight(h.total_node_weight),
+                                  Flow(h.max_hyperedge_capacity));
+        }
+
+        // the counterpart of WHFC_IO::readAdditionalInformation. returns false if the snapshot was written without side information
+        static bool readAdditionalInformation(const std::string& filename, WHFC_IO::WHFCInformation& info) {
+            std::ifstream f(filename, std::ios::binary);
+            Header h;
+            if (!f.read(reinterpret_cast<char*>(&h), sizeof(Header)) || std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+                throw std::runtime_error("File: " + filename + " is not a snapshot.");
+            if (!h.has_information)
+                return false;
+            info.maxBlockWeight[0] = h.max_block_weight[0];
+            info.maxBlockWeight[1] = h.max_block_weight[1];
+            info.upperFlowBound = h.upper_flow_bound;
+            info.s = Node(h.s);
+            info.t = Node(h.t);
+            return true;
+        }
+
+    private:
+        static_assert(std::is_trivially_copyable_v<FlowHypergraph::NodeData> && std::is_trivially_copyable_v<FlowHypergraph::HyperedgeData> &&
+                      std::is_trivially_copyable_v<FlowHypergraph::Pin> && std::is_trivially_copyable_v<FlowHypergraph::InHe>);
+
+        template<typename T>
+        static MappableVector<T> mapArray(char* base, uint64_t offset, size_t n, const std::shared_ptr<const void>& holder) {
+            return MappableVector<T>(reinterpret_cast<T*>(base + offset), n, holder);
+        }
+
+        static size_t align(size_t x) { return (x + alignment - 1) / alignment * alignment; }
+
+        static void setElementSizes(uint32_t* sizes) {
+            sizes[0] = sizeof(FlowHypergraph::NodeData);
+            sizes[1] = sizeof(FlowHypergraph::HyperedgeData);
+            sizes[2] = sizeof(FlowHypergraph::Pin);
+            sizes[3] = sizeof(FlowHypergraph::InHe);
+        }
+
+        static void checkHeader(const Header& h, size_t length, const std::string& filename) {
+            if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+                throw std::runtime_error("File: " + filename + " is not a snapshot.");
+            if (h.version != version)
+                throw std::runtime_error("File: " + filename + " has unsupported snapshot version " + std::to_string(h.version));
+            if (h.byte_order_mark != byte_order_mark)
+                throw std::runtime_error("File: " + filename + " was written with a different byte order.");
+            uint32_t sizes[4];
+            setElementSizes(sizes);
+            if (std::memcmp(sizes, h.element_sizes, sizeof(sizes)) != 0)
+                throw std::runtime_error("File: " + filename + " was written with different element sizes.");
+            auto in_bounds = [&](uint64_t offset, uint64_t n, size_t element_size) {
+                return offset % alignment == 0 && offset >= sizeof(Header) && offset <= length && n <= (length - offset) / element_size;
+            };
+            if (h.file_size > length || !in_bounds(h.nodes_offset, h.num_nodes + 1, sizeof(FlowHypergraph::NodeData)) ||
+                !in_bounds(h.hyperedges_offset, h.num_hyperedges + 1, sizeof(FlowHypergraph::HyperedgeData)) ||
+                !in_bounds(h.pins_offset, h.num_pins, sizeof(FlowHypergraph::Pin)) ||
+                !in_bounds(h.incident_hyperedges_offset, h.num_pins, sizeof(FlowHypergraph::InHe)))
+                throw std::runtime_error("File: " + filename + " is truncated or has corrupted offsets.");
+        }
+    };
+} // namespace whfc
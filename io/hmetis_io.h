@@ -1,8 +1,11 @@
 #pragma once
 
 #include <fstream>
+#include <sstream>
+#include <tuple>
 #include "../datastructure/flow_hypergraph.h"
 #include "../datastructure/flow_hypergraph_builder.h"
+#include "hmetis_parser.h"
 
 namespace whfc {
     class HMetisIO {
@@ -15,12 +18,7 @@ namespace whfc {
         }
 
     public:
-        enum class HGType : uint8_t {
-            Unweighted = 0,
-            EdgeWeights = 1,
-            NodeWeights = 10,
-            EdgeAndNodeWeights = 11,
-        };
+        using HGType = HMetisParser::HGType;
 
 
         static auto readHeader(std::ifstream& f) {
@@ -46,126 +44,25 @@ namespace whfc {
         }
 
         static FlowHypergraphBuilder& readFlowHypergraphWithBuilder(FlowHypergraphBuilder& hgb, const std::string& filename) {
-            std::ifstream f(filename);
-            if (!f)
-                throw std::runtime_error("File: " + filename + " not found.");
-
-            auto [numNodes, numHEs, hg_type] = readHeader(f);
+            HMetisParser::ParsedHypergraph p = HMetisParser::parse(filename, /*remove_single_pin_hyperedges=*/false);
             hgb.clear();
-            hgb.reinitialize(numNodes);
-
-            std::string line;
-
-            bool hasHyperedgeWeights = hg_type == HGType::EdgeAndNodeWeights || hg_type == HGType ::EdgeWeights;
-            bool hasNodeWeights = hg_type == HGType::EdgeAndNodeWeights || hg_type == HGType::NodeWeights;
+            hgb.reinitialize(p.num_nodes);
 
-            for (size_t e = 0; e < numHEs; ++e) {
-                mgetline(f, line);
-                std::istringstream iss(line);
-                uint32_t pin;
-                uint32_t he_weight = 1;
+            std::vector<size_t> offsets(p.hyperedge_sizes.size() + 1);
+            offsets.back() = parallelPrefixSum<size_t>(
+                    p.hyperedge_sizes.size(), [&](size_t e) { return size_t(p.hyperedge_sizes[e]); }, [&](size_t e, size_t sum) { offsets[e] = sum; });
+            hgb.appendHyperedgesFromCSR(p.hyperedge_sizes.size(), offsets, p.pins, p.hyperedge_weights);
 
-                if (hasHyperedgeWeights)
-                    iss >> he_weight;
-
-                hgb.startHyperedge(he_weight);
-                size_t he_size = 0;
-                while (iss >> pin) {
-                    if (pin < 1)
-                        throw std::runtime_error("File: " + filename + " has pin id < 1 (in one-based ids).");
-                    if (pin > numNodes)
-                        throw std::runtime_error("File: " + filename + " has pin id > number of nodes.");
-                    hgb.addPin(Node(pin - 1));
-                    he_size++;
-                }
-                if (he_size <= 1)
-                    throw std::runtime_error("File: " + filename + " has pin with zero or one pins.");
-            }
-
-            for (Node u(0); u < numNodes; ++u) {
-                NodeWeight nw(1);
-                if (hasNodeWeights) {
-                    mgetline(f, line);
-                    std::istringstream iss(line);
-                    iss >> nw;
-                }
-                hgb.nodeWeight(u) = nw;
-            }
+            tbb::parallel_for(size_t(0), size_t(p.num_nodes), [&](size_t u) { hgb.nodeWeight(Node(u)) = p.node_weights[u]; });
 
             hgb.finalize();
-
-            f.close();
             return hgb;
         }
 
 
         static FlowHypergraph readFlowHypergraph(const std::string& filename) {
-
-            std::vector<NodeWeight> nodeWeights;
-            std::vector<HyperedgeWeight> hyperedgeWeights;
-            std::vector<Node> pins;
-            std::vector<PinIndex> hyperedgeSizes;
-
-            std::ifstream f(filename);
-            if (!f)
-                throw std::runtime_error("File: " + filename + " not found.");
-
-            auto [numNodes, numHEs, hg_type] = readHeader(f);
-
-            std::string line;
-
-            bool hasHyperedgeWeights = hg_type == HGType::EdgeAndNodeWeights || hg_type == HGType ::EdgeWeights;
-
-            bool hasNodeWeights = hg_type == HGType::EdgeAndNodeWeights || hg_type == HGType::NodeWeights;
-            if (!hasNodeWeights)
-                nodeWeights.resize(numNodes, NodeWeight(1));
-
-            for (size_t e = 0; e < numHEs; ++e) {
-                mgetline(f, line);
-                std::istringstream iss(line);
-                uint32_t pin;
-                uint32_t he_size = 0;
-                uint32_t he_weight = 1;
-
-                if (hasHyperedgeWeights)
-                    iss >> he_weight;
-                hyperedgeWeights.emplace_back(he_weight);
-
-                while (iss >> pin) {
-                    if (pin < 1)
-                        throw std::runtime_error("File: " + filename + " has pin id < 1 (in one-based ids).");
-                    if (pin > numNodes)
-                        throw std::runtime_error("File: " + filename + " has pin id > number of nodes.");
-                    he_size++;
-                    pins.emplace_back(pin - 1);
-                }
-                hyperedgeSizes.emplace_back(he_size);
-
-                if (he_size > numNodes)
-                    throw std::runtime_error("File: " + filename + " has hyperedge with more pins than nodes in the hypergraph.");
-                if (he_size == 0)
-                    throw std::runtime_error("File: " + filename + " has hyperedge with zero pins.");
-                if (he_size == 1) {
-                    // ignore single pin hyperedges
-                    pins.pop_back();
-                    hyperedgeWeights.pop_back();
-                    hyperedgeSizes.pop_back();
-                }
-            }
-
-            if (hasNodeWeights) {
-                for (size_t u = 0; u < numNodes; ++u) {
-                    uint32_t nw;
-                    mgetline(f, line);
-                    std::istringstream iss(line);
-                    iss >> nw;
-                    nodeWeights.emplace_back(nw);
-                }
-            }
-
-            f.close();
-
-            return FlowHypergraph(nodeWeights, hyperedgeWeights, hyperedgeSizes, pins);
+            HMetisParser::ParsedHypergraph p = HMetisParser::parse(filename, /*remove_single_pin_hyperedges=*/true);
+            return FlowHypergraph(p.node_weights, p.hyperedge_weights, p.hyperedge_sizes, p.pins);
         }
 
         static void writeFlowHypergraph(FlowHypergraph& hg, std::string& filename) {
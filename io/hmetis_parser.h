@@ -0,0 +1,240 @@
+#pragma once
+
+#include <fcntl.h>
+#include <limits>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tbb/parallel_for.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../definitions.h"
+#include "../util/prefix_sum.h"
+
+namespace whfc {
+
+    /*
+     * Parallel parser for hMetis files. The file is mapped, line starts are collected per chunk in parallel, and hyperedge and node weight
+     * lines are parsed with a hand-written integer scanner in parallel. Pins are written to their final position, which a count pass
+     * and a prefix sum over the hyperedge sizes determine. Accepts the same files as the istringstream-based parsing: lines starting with
+     * '%' are comments, and the integers of a line end at its first character that is neither a digit nor whitespace.
+     */
+    class HMetisParser {
+    public:
+        enum class HGType : uint8_t {
+            Unweighted = 0,
+            EdgeWeights = 1,
+            NodeWeights = 10,
+            EdgeAndNodeWeights = 11,
+        };
+
+        struct ParsedHypergraph {
+            size_t num_nodes = 0, num_hyperedges = 0; // as in the header
+            HGType type = HGType::Unweighted;
+            std::vector<NodeWeight> node_weights;
+            std::vector<HyperedgeWeight> hyperedge_weights;
+            std::vector<PinIndex> hyperedge_sizes;
+            std::vector<Node> pins;
+        };
+
+        // the two modes validate like the two line-based readers did. with remove_single_pin_hyperedges = false (readFlowHypergraphWithBuilder),
+        // hyperedges with one pin are an error. with true (readFlowHypergraph), hyperedges with more pins than nodes are an error
+        static ParsedHypergraph parse(const std::string& filename, bool remove_single_pin_hyperedges) {
+            MappedFile file(filename);
+            const std::vector<size_t> lines = findLineStarts(file.data, file.size);
+            ParsedHypergraph res;
+            if (lines.empty())
+                throw std::runtime_error("File: " + filename + " has no header.");
+
+            {
+                // header
+                std::vector<uint64_t> header;
+                scanIntegers(file.data + lines[0], file.data + file.size, filename, [&](uint64_t x) { header.push_back(x); });
+                if (header.size() < 2)
+                    throw std::runtime_error("File: " + filename + " has an invalid header.");
+                res.num_hyperedges = narrow<Hyperedge::ValueType>(header[0], filename, "number of hyperedges");
+                res.num_nodes = narrow<Node::ValueType>(header[1], filename, "number of nodes");
+                if (header.size() >= 3)
+                    res.type = static_cast<HGType>(narrow<uint8_t>(header[2], filename, "hypergraph type"));
+            }
+            const bool has_hyperedge_weights = res.type == HGType::EdgeAndNodeWeights || res.type == HGType::EdgeWeights;
+            const bool has_node_weights = res.type == HGType::EdgeAndNodeWeights || res.type == HGType::NodeWeights;
+            const size_t num_nodes = res.num_nodes, num_hyperedges = res.num_hyperedges;
+
+            auto line = [&](size_t i) -> const char* { return i < lines.size() ? file.data + lines[i] : file.data + file.size; }; // missing lines are empty
+            auto hyperedgeLine = [&](size_t e) { return line(1 + e); };
+
+            // count pass: sizes of the hyperedges that are kept, and whether they are kept
+            std::vector<PinIndex> sizes(num_hyperedges);
+            std::vector<uint32_t> kept(num_hyperedges);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, num_hyperedges, 1024), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t e = r.begin(); e < r.end(); ++e) {
+                    size_t tokens = 0;
+                    scanIntegers(hyperedgeLine(e), file.data + file.size, filename, [&](uint64_t) { tokens++; });
+                    const size_t he_size = has_hyperedge_weights && tokens > 0 ? tokens - 1 : tokens;
+                    if (he_size <= 1 && !remove_single_pin_hyperedges)
+                        throw std::runtime_error("File: " + filename + " has pin with zero or one pins.");
+                    if (he_size > num_nodes && remove_single_pin_hyperedges)
+                        throw std::runtime_error("File: " + filename + " has hyperedge with more pins than nodes in the hypergraph.");
+                    if (he_size == 0)
+                        throw std::runtime_error("File: " + filename + " has hyperedge with zero pins.");
+                    kept[e] = he_size != 1;
+                    sizes[e] = PinIndex::fromOtherValueType(kept[e] ? he_size : 0);
+                }
+            });
+
+            // positions of the kept hyperedges and their pins
+            std::vector<uint64_t> pin_offset(num_hyperedges);
+            const size_t num_pins = parallelPrefixSum<uint64_t>(
+                    num_hyperedges, [&](size_t e) { return uint64_t(sizes[e]); }, [&](size_t e, uint64_t sum) { pin_offset[e] = sum; });
+            if (num_pins >= PinIndex::InvalidValue)
+                throw std::runtime_error("File: " + filename + " has too many pins.");
+            const size_t num_kept = parallelPrefixSum<uint32_t>(
+                    num_hyperedges, [&](size_t e) { return kept[e]; }, [&](size_t e, uint32_t sum) { kept[e] = kept[e] ? sum : invalidIndex; });
+
+            // write pass
+            res.hyperedge_weights.resize(num_kept);
+            res.hyperedge_sizes.resize(num_kept);
+            res.pins.resize(num_pins);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, num_hyperedges, 1024), [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t e = r.begin(); e < r.end(); ++e) {
+                    if (kept[e] == invalidIndex) {
+                        continue;
+                    }
+                    HyperedgeWeight he_weight = 1;
+                    Node* out = res.pins.data() + pin_offset[e];
+                    bool first = true;
+                    scanIntegers(hyperedgeLine(e), file.data + file.size, filename, [&](uint64_t x) {
+                        if (has_hyperedge_weights && first) {
+                            he_weight = narrow<HyperedgeWeight>(x, filename, "hyperedge weight");
+                        } else {
+                            if (x < 1)
+                                throw std::runtime_error("File: " + filename + " has pin id < 1 (in one-based ids).");
+                            if (x > num_nodes)
+                                throw std::runtime_error("File: " + filename + " has pin id > number of nodes.");
+                            *out++ = Node(x - 1);
+                        }
+                        first = false;
+                    });
+                    res.hyperedge_weights[kept[e]] = he_weight;
+                    res.hyperedge_sizes[kept[e]] = sizes[e];
+                }
+            });
+
+            // node weights
+            res.node_weights.resize(num_nodes, NodeWeight(1));
+            if (has_node_weights) {
+                if (lines.size() < 1 + num_hyperedges + num_nodes)
+                    throw std::runtime_error("File: " + filename + " has fewer node weights than nodes.");
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, num_nodes, 4096), [&](const tbb::blocked_range<size_t>& r) {
+                    for (size_t u = r.begin(); u < r.end(); ++u) {
+                        bool first = true;
+                        scanIntegers(line(1 + num_hyperedges + u), file.data + file.size, filename, [&](uint64_t x) {
+                            if (first) {
+                                res.node_weights[u] = narrow<NodeWeight>(x, filename, "node weight");
+                            }
+                            first = false;
+                        });
+                    }
+                });
+            }
+            return res;
+        }
+
+    private:
+        struct MappedFile {
+            const char* data = nullptr;
+            size_t size = 0;
+
+            explicit MappedFile(const std::string& filename) {
+                const int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd < 0)
+                    throw std::runtime_error("File: " + filename + " not found.");
+                struct stat st;
+                if (::fstat(fd, &st) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("File: " + filename + " not found.");
+                }
+                size = st.st_size;
+                if (size > 0) {
+                    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (addr == MAP_FAILED) {
+                        ::close(fd);
+                        throw std::runtime_error("File: " + filename + " could not be mapped.");
+                    }
+                    ::madvise(addr, size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(addr);
+                }
+                ::close(fd);
+            }
+            ~MappedFile() {
+                if (data) {
+                    ::munmap(const_cast<char*>(data), size);
+                }
+            }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+        };
+
+        static bool isWhitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+        static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+        // calls f for every unsigned integer of the line starting at p, until the end of the line or a character that is neither a digit nor whitespace
+        template<typename F>
+        static void scanIntegers(const char* p, const char* end, const std::string& filename, F&& f) {
+            while (p != end) {
+                while (p != end && isWhitespace(*p)) {
+                    ++p;
+                }
+                if (p == end || !isDigit(*p)) {
+                    return;
+                }
+                uint64_t x = 0;
+                for (; p != end && isDigit(*p); ++p) {
+                    const uint64_t digit = uint64_t(*p - '0');
+                    if (x > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+                        throw std::runtime_error("File: " + filename + " has an integer that does not fit into 64 bits.");
+                    x = 10 * x + digit;
+                }
+                f(x);
+            }
+        }
+
+        template<typename T>
+        static T narrow(uint64_t x, const std::string& filename, const char* what) {
+            if (x > uint64_t(std::numeric_limits<T>::max()))
+                throw std::runtime_error("File: " + filename + " has " + what + " " + std::to_string(x) + ", which does not fit into its type.");
+            return T(x);
+        }
+
+        // starts of the lines that are not comments. a line starts at 0 and after every newline, except at the end of the file
+        static std::vector<size_t> findLineStarts(const char* data, size_t size) {
+            static constexpr size_t chunk_size = 1 << 20;
+            const size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+            auto forEachLineStart = [&](size_t chunk, auto&& f) {
+                const size_t last = std::min(size, (chunk + 1) * chunk_size);
+                for (size_t p = chunk * chunk_size; p < last; ++p) {
+                    if ((p == 0 || data[p - 1] == '\n') && data[p] != '%') {
+                        f(p);
+                    }
+                }
+            };
+            std::vector<size_t> lines_per_chunk(num_chunks);
+            tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+                size_t n = 0;
+                forEachLineStart(chunk, [&](size_t) { n++; });
+                lines_per_chunk[chunk] = n;
+            });
+            const size_t num_lines = parallelPrefixSum<size_t>(
+                    num_chunks, [&](size_t c) { return lines_per_chunk[c]; }, [&](size_t c, size_t sum) { lines_per_chunk[c] = sum; });
+            std::vector<size_t> line_starts(num_lines);
+            tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+                size_t i = lines_per_chunk[chunk];
+                forEachLineStart(chunk, [&](size_t p) { line_starts[i++] = p; });
+            });
+            return line_starts;
+        }
+    };
+
+} // namespace whfc
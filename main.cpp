@@ -17,6 +17,7 @@ namespace whfc {
 
         hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(s, t);
         hfc.timer.report(std::cout);
+        hfc.cs.flow_algo.instrumentation.writeJSON(std::cout, "ParallelPushRelabel");
     }
 } // namespace whfc
 
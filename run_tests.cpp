@@ -1,8 +1,10 @@
 #include "tests/flow_hypergraph_tests.h"
+#include "tests/hmetis_io_tests.h"
 #include "tests/subset_sum_tests.h"
 
 int main(int argc, char* argv[]) {
     whfc::Test::SubsetSumTests().run();
     whfc::Test::FlowHypergraphTests().run();
+    whfc::Test::HMetisIOTests().run();
     return 0;
 }
@@ -0,0 +1,28 @@
+#include <fstream>
+#include <iostream>
+#include "io/binary_snapshot_io.h"
+#include "io/hmetis_io.h"
+#include "io/whfc_io.h"
+
+namespace whfc {
+    void convert(const std::string& hgfile, const std::string& snapshot_file) {
+        FlowHypergraph hg = HMetisIO::readFlowHypergraph(hgfile);
+        WHFC_IO::WHFCInformation info;
+        const bool has_information = static_cast<bool>(std::ifstream(hgfile + ".whfc"));
+        if (has_information) {
+            info = WHFC_IO::readAdditionalInformation(hgfile);
+        }
+        BinarySnapshotIO::writeSnapshot(hg, has_information ? &info : nullptr, snapshot_file);
+        std::cout << "wrote " << snapshot_file << " (n,m,p) = " << hg.numNodes() << " " << hg.numHyperedges() << " " << hg.numPins()
+                  << (has_information ? " with " : " without ") << hgfile << ".whfc" << std::endl;
+    }
+} // namespace whfc
+
+int main(int argc, const char* argv[]) {
+    if (argc < 2 || argc > 3)
+        throw std::runtime_error("Usage: ./SnapshotConverter hypergraphfile [snapshotfile, default: hypergraphfile.bin]");
+    std::string hgfile = argv[1];
+    std::string snapshot_file = argc == 3 ? std::string(argv[2]) : hgfile + ".bin";
+    whfc::convert(hgfile, snapshot_file);
+    return 0;
+}
@@ -11,45 +11,13 @@
 #include "util/tbb_thread_pinning.h"
 
 namespace whfc {
-    void pin() {
-        int slot = 0;
-        cpu_set_t target_mask;
-        CPU_ZERO(&target_mask);
-        CPU_SET(slot, &target_mask);
-        size_t size = CPU_ALLOC_SIZE(std::thread::hardware_concurrency());
-        int err = sched_setaffinity(0, size, &target_mask);
-        if (err) {
-            std::cout << "couldnt set thread affinity" << std::endl;
-            std::exit(1);
-        }
-    }
-
-    void unpin() {
-        cpu_set_t target_mask;
-        CPU_ZERO(&target_mask);
-        for (size_t core = 0; core < std::thread::hardware_concurrency(); ++core) {
-            CPU_SET(core, &target_mask);
-        }
-        size_t size = CPU_ALLOC_SIZE(std::thread::hardware_concurrency());
-        int err = sched_setaffinity(0, size, &target_mask);
-        if (err) {
-            std::cout << "couldnt reset thread affinity" << std::endl;
-            std::exit(1);
-        }
-    }
-
-
     void runSnapshotTester(const std::string& filename, int max_threads) {
         static constexpr bool log = true;
-        pin();
-
-        unpin();
 
         // for (size_t threads = 32; threads <= 32; threads *= 2) {
         size_t threads = max_threads;
         auto gc = tbb::global_control{ tbb::global_control::max_allowed_parallelism, threads };
-        whfc::pinning_observer thread_pinner;
-        thread_pinner.observe(true);
+        PinnedArena arena(CpuTopology::read(), PinningPolicy::Compact, threads);
 
         std::vector<int> first_partition;
 
@@ -68,6 +36,7 @@ namespace whfc {
             using FlowAlgorithm = ParallelPushRelabel;
             // using FlowAlgorithm = SequentialPushRelabel;
             HyperFlowCutter<FlowAlgorithm> hfc(hg, seed, /*deterministic=*/true);
+            hfc.setArena(&arena.taskArena());
             hfc.setFlowBound(info.upperFlowBound);
             hfc.forceSequential(false);
             hfc.setBulkPiercing(false);
@@ -1,8 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "../algorithm/adaptive_hyperflowcutter.h"
+#include "../algorithm/async_push_relabel.h"
+#include "../algorithm/augmenting_path_flow.h"
+#include "../algorithm/excess_scaling_push_relabel.h"
+#include "../algorithm/hyperflowcutter_pool.h"
+#include "../algorithm/interleaved_hyperflowcutters.h"
 #include "../algorithm/parallel_push_relabel.h"
+#include "../algorithm/sequential_push_relabel.h"
+#include "../io/binary_snapshot_io.h"
 #include "../io/hmetis_io.h"
 #include "../logger.h"
+#include "../util/tbb_thread_pinning.h"
+#include "test_check.h"
 
 namespace whfc::Test {
 
@@ -10,25 +26,852 @@ namespace whfc::Test {
     public:
         static constexpr bool log = true;
 
-        bool tryFlowAlgo2(std::string file, Flow expected_flow, Node s, Node t) {
+        struct Instance {
+            std::string file;
+            Node s, t;
+            Flow max_flow;
+        };
+        // large_nets has hyperedges with 33 to 150 pins, and a max flow of 118
+        const std::vector<Instance> instances = {
+            { "../test_hypergraphs/testhg.hgr", Node(14), Node(10), 1 },
+            { "../test_hypergraphs/twocenters.hgr", Node(0), Node(2), 2 },
+            { "../test_hypergraphs/twocenters.hgr", Node(0), Node(3), 2 },
+            { "../test_hypergraphs/push_back.hgr", Node(0), Node(7), 6 },
+            { "../test_hypergraphs/large_nets.hgr", Node(0), Node(399), 118 },
+        };
+
+        struct Ignore {
+            template<typename... Args>
+            void operator()(Args&&...) const {}
+        };
+
+        // runs findMinCuts with a fresh FlowAlgorithm on every instance and checks the flow value. configure(fa) sets options before the run,
+        // inspect(fa, instance) checks more of the result
+        template<typename FlowAlgorithm, typename Configure = Ignore, typename Inspect = Ignore>
+        void minCutTest(Configure&& configure = {}, Inspect&& inspect = {}) {
+            for (const Instance& instance : instances) {
+                FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+                FlowAlgorithm fa(hg);
+                configure(fa);
+                fa.reset();
+                fa.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fa.findMinCuts());
+                WHFC_TEST_CHECK(fa.flow_value == instance.max_flow);
+                inspect(fa, instance);
+            }
+        }
+
+        template<typename Range>
+        static std::vector<Node> nodesOf(const Range& range) {
+            std::vector<Node> nodes;
+            for (Node u : range) {
+                nodes.push_back(u);
+            }
+            return nodes;
+        }
+
+        template<typename FlowAlgorithm>
+        static std::vector<Node> sourceSide(const FlowAlgorithm& fa) {
+            std::vector<Node> nodes = nodesOf(fa.sourceReachableNodes());
+            std::sort(nodes.begin(), nodes.end());
+            return nodes;
+        }
+
+        // one engine solves the large instance, then the others inside its buffers, then the large one again.
+        // the sparse reset only clears what the previous run touched, which must be indistinguishable from the full reset
+        template<typename FlowAlgorithm>
+        void sparseResetTest() {
+            std::vector<Instance> sequence = { instances.back() };
+            sequence.insert(sequence.end(), instances.begin(), instances.end());
+            for (bool sparse_reset : { false, true }) {
+                FlowHypergraphBuilder hg;
+                FlowAlgorithm fa(hg);
+                fa.sparse_reset = sparse_reset;
+                for (const Instance& instance : sequence) {
+                    HMetisIO::readFlowHypergraphWithBuilder(hg, instance.file);
+                    fa.reset();
+                    fa.initialize(instance.s, instance.t);
+                    WHFC_TEST_CHECK(fa.findMinCuts() && fa.flow_value == instance.max_flow);
+                }
+            }
+        }
+
+        // narrower storage must not change the flow. all instances fit into 16 bits
+        template<typename CompactFlowAlgorithm, typename FlowAlgorithm>
+        void compactStorageTest() {
+            minCutTest<CompactFlowAlgorithm>(Ignore(), [&](CompactFlowAlgorithm& compact, const Instance& instance) {
+                WHFC_TEST_CHECK(CompactFlowAlgorithm::fitsStorage(compact.hg));
+                FlowAlgorithm fa(compact.hg);
+                fa.reset();
+                fa.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fa.findMinCuts() && fa.flow_value == compact.flow_value);
+                if constexpr (std::is_same_v<FlowAlgorithm, SequentialPushRelabel>) { // same pushes in the same order
+                    WHFC_TEST_CHECK(sourceSide(fa) == sourceSide(compact));
+                }
+            });
+        }
+
+        // thresholds that let every layer after the first run bottom-up. the distance labels must equal those of the top-down BFS
+        void directionOptimizingBFSTest() {
+            auto force_bottom_up = [](ParallelPushRelabel& pr) { pr.bottom_up_alpha = pr.bottom_up_beta = size_t(1) << 30; };
+            size_t bottom_up_layers = 0;
+            minCutTest<ParallelPushRelabel>(force_bottom_up, [&](ParallelPushRelabel& pr, const Instance&) {
+                bottom_up_layers += pr.num_bottom_up_layers;
+                // the labels of the residual network at the end of the run
+                pr.direction_optimizing_global_relabel = false;
+                pr.globalRelabel<false>();
+                const std::vector<int> top_down(pr.level.begin(), pr.level.end());
+                pr.direction_optimizing_global_relabel = true;
+                const size_t before = pr.num_bottom_up_layers;
+                pr.globalRelabel<false>();
+                WHFC_TEST_CHECK(std::equal(top_down.begin(), top_down.end(), pr.level.begin(), pr.level.end()));
+                WHFC_TEST_CHECK(pr.num_bottom_up_layers > before);
+            });
+            WHFC_TEST_CHECK(bottom_up_layers > 0);
+        }
+
+        // every layer of the target-side BFS runs in parallel. in deterministic mode, the queue order must not change between runs,
+        // and the cut must equal that of the sequential BFS
+        void parallelTargetSideCutTest() {
+            tbb::task_arena arena(4);
+            arena.execute([&] {
+                std::vector<std::vector<Node>> first_run;
+                for (int run = 0; run < 3; ++run) {
+                    size_t i = 0;
+                    minCutTest<ParallelPushRelabel>([](ParallelPushRelabel& pr) { pr.deterministic = true; }, [&](ParallelPushRelabel& pr, const Instance&) {
+                        pr.parallel_target_side_cut = false;
+                        pr.deriveTargetSideCut();
+                        std::vector<Node> sequential = nodesOf(pr.targetReachableNodes());
+                        std::sort(sequential.begin(), sequential.end());
+
+                        pr.parallel_target_side_cut = true;
+                        pr.parallel_bfs_layer_threshold = 1;
+                        pr.deriveTargetSideCut();
+                        std::vector<Node> parallel = nodesOf(pr.targetReachableNodes());
+                        WHFC_TEST_CHECK(pr.num_parallel_bfs_layers > 0);
+                        if (run == 0) {
+                            first_run.push_back(parallel);
+                        } else {
+                            WHFC_TEST_CHECK(parallel == first_run[i]);
+                        }
+                        i++;
+                        std::sort(parallel.begin(), parallel.end());
+                        WHFC_TEST_CHECK(parallel == sequential);
+                    });
+                }
+            });
+        }
+
+        // concurrent discharges on four threads. the nodes reachable from the source in the residual network are the same for every max flow
+        void asyncTest() {
+            tbb::task_arena arena(4);
+            arena.execute([&] {
+                minCutTest<AsyncPushRelabel>(Ignore(), [&](AsyncPushRelabel& async, const Instance& instance) {
+                    SequentialPushRelabel seq(async.hg);
+                    seq.reset();
+                    seq.initialize(instance.s, instance.t);
+                    WHFC_TEST_CHECK(seq.findMinCuts());
+                    WHFC_TEST_CHECK(sourceSide(async) == sourceSide(seq));
+                });
+            });
+        }
+
+        // without hysteresis, small thresholds switch between the sequential and the parallel discharge. neither the flow nor the cut may change
+        void sequentialFallbackTest() {
+            tbb::task_arena arena(4);
+            arena.execute([&] {
+                for (size_t threshold : { size_t(2), size_t(8), size_t(128), size_t(1) << 20 }) {
+                    size_t fallbacks = 0, exits = 0;
+                    minCutTest<ParallelPushRelabel>(
+                            [&](ParallelPushRelabel& pr) {
+                                pr.sequential_fallback_threshold = threshold;
+                                pr.sequential_fallback_hysteresis = 1;
+                            },
+                            [&](ParallelPushRelabel& pr, const Instance& instance) {
+                                fallbacks += pr.num_sequential_fallbacks;
+                                exits += pr.num_sequential_fallback_exits;
+                                ParallelPushRelabel parallel_only(pr.hg);
+                                parallel_only.sequential_fallback_threshold = 0;
+                                parallel_only.reset();
+                                parallel_only.initialize(instance.s, instance.t);
+                                WHFC_TEST_CHECK(parallel_only.findMinCuts() && parallel_only.num_sequential_fallbacks == 0);
+                                WHFC_TEST_CHECK(sourceSide(pr) == sourceSide(parallel_only));
+                            });
+                    WHFC_TEST_CHECK(fallbacks > 0);
+                    WHFC_TEST_CHECK(threshold > 2 || exits > 0); // leaves as soon as three nodes are queued
+                }
+            });
+        }
+
+        template<typename FlowAlgorithm>
+        static std::vector<Node> targetSide(const FlowAlgorithm& fa) {
+            std::vector<Node> nodes = nodesOf(fa.targetReachableNodes());
+            std::sort(nodes.begin(), nodes.end());
+            return nodes;
+        }
+
+        // nodes 0 to capacities.size() with hyperedge {i, i + 1} of capacity capacities[i]
+        static void buildPath(FlowHypergraphBuilder& path, const std::vector<Flow>& capacities) {
+            path.reinitialize(capacities.size() + 1);
+            for (size_t i = 0; i < capacities.size(); ++i) {
+                path.startHyperedge(capacities[i]);
+                path.addPin(Node(i));
+                path.addPin(Node(i + 1));
+            }
+            path.finalize();
+        }
+
+        // both cuts are the same for every max flow, so highest-label selection and the gap heuristic must reproduce those of FIFO
+        void highestLabelTest() {
+            minCutTest<HighestLabelSequentialPushRelabel>(Ignore(), [&](HighestLabelSequentialPushRelabel& hl, const Instance& instance) {
+                SequentialPushRelabel fifo(hl.hg);
+                fifo.reset();
+                fifo.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fifo.findMinCuts());
+                WHFC_TEST_CHECK(sourceSide(hl) == sourceSide(fifo) && targetSide(hl) == targetSide(fifo));
+            });
+
+            // a path whose last hyperedge is the bottleneck. the excess stranded in front of it is alone on its level, so its relabel leaves a gap
+            FlowHypergraphBuilder path;
+            buildPath(path, { 2, 2, 1 });
+            HighestLabelSequentialPushRelabel hl(path);
+            hl.reset();
+            hl.initialize(Node(0), Node(3));
+            WHFC_TEST_CHECK(hl.findMinCuts() && hl.flow_value == 1 && hl.num_gaps > 0);
+        }
+
+        // skewed capacities start with a large scaling parameter, which must halve down to 1 without changing the cuts of FIFO
+        void excessScalingTest() {
+            minCutTest<ExcessScalingPushRelabel>(Ignore(), [&](ExcessScalingPushRelabel& es, const Instance& instance) {
+                SequentialPushRelabel fifo(es.hg);
+                fifo.reset();
+                fifo.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fifo.findMinCuts());
+                WHFC_TEST_CHECK(sourceSide(es) == sourceSide(fifo) && targetSide(es) == targetSide(fifo));
+            });
+
+            FlowHypergraphBuilder path;
+            buildPath(path, { 1000, 1000, 3, 1000 });
+            ExcessScalingPushRelabel es(path);
+            WHFC_TEST_CHECK(es.computeMaxFlow(Node(0), Node(4)) == 3 && es.num_scaling_phases == 11); // delta = 1024, ..., 1
+        }
+
+        // the engine keeps no levels. its cuts must equal those of push-relabel
+        void augmentingPathTest() {
+            minCutTest<AugmentingPathFlow>(Ignore(), [&](AugmentingPathFlow& ap, const Instance& instance) {
+                WHFC_TEST_CHECK(ap.level.empty() && ap.num_augmenting_paths > 0);
+                SequentialPushRelabel fifo(ap.hg);
+                fifo.reset();
+                fifo.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fifo.findMinCuts());
+                WHFC_TEST_CHECK(sourceSide(ap) == sourceSide(fifo) && targetSide(ap) == targetSide(fifo));
+            });
+        }
+
+        // the per-phase counters of a build with WHFC_INSTRUMENTATION. the instances are solved twice without clear(), so every counter doubles
+        // for the sequential engine, and at least grows for the parallel ones
+        template<typename FlowAlgorithm>
+        void instrumentationTest() {
+            minCutTest<FlowAlgorithm>(Ignore(), [&](FlowAlgorithm& fa, const Instance& instance) {
+                auto& instrumentation = fa.instrumentation;
+                if constexpr (!instrumentation_enabled) {
+                    WHFC_TEST_CHECK(instrumentation.statistics(PushRelabelPhase::Discharge).rounds == 0);
+                    return;
+                }
+                std::array<PushRelabelPhaseStatistics, num_push_relabel_phases> first;
+                for (size_t i = 0; i < num_push_relabel_phases; ++i) {
+                    first[i] = instrumentation.statistics(static_cast<PushRelabelPhase>(i));
+                }
+                const auto& saturate = first[static_cast<size_t>(PushRelabelPhase::Saturate)];
+                const auto& global_relabel = first[static_cast<size_t>(PushRelabelPhase::GlobalRelabel)];
+                const auto& source_cut = first[static_cast<size_t>(PushRelabelPhase::SourceCut)];
+                PushRelabelPhaseStatistics discharge = first[static_cast<size_t>(PushRelabelPhase::Discharge)];
+                const auto& sequential_discharge = first[static_cast<size_t>(PushRelabelPhase::SequentialDischarge)];
+                discharge.pushes += sequential_discharge.pushes;
+                discharge.relabels += sequential_discharge.relabels;
+                discharge.edges_scanned += sequential_discharge.edges_scanned;
+                discharge.active_nodes += sequential_discharge.active_nodes;
+
+                WHFC_TEST_CHECK(saturate.rounds == 1 && source_cut.rounds >= 1);
+                WHFC_TEST_CHECK(discharge.pushes > 0 && discharge.active_nodes > 0 && discharge.edges_scanned > 0);
+                // the first global relabel scans at least the target piercing node
+                WHFC_TEST_CHECK(global_relabel.rounds >= 1 && global_relabel.edges_scanned >= global_relabel.rounds);
+                for (const PushRelabelPhaseStatistics& s : first) {
+                    WHFC_TEST_CHECK(s.seconds >= 0.0 && (s.rounds > 0 || (s.pushes == 0 && s.relabels == 0 && s.edges_scanned == 0)));
+                }
+
+                fa.reset();
+                fa.initialize(instance.s, instance.t);
+                WHFC_TEST_CHECK(fa.findMinCuts() && fa.flow_value == instance.max_flow);
+                for (size_t i = 0; i < num_push_relabel_phases; ++i) {
+                    const PushRelabelPhaseStatistics s = instrumentation.statistics(static_cast<PushRelabelPhase>(i));
+                    if constexpr (std::is_same_v<FlowAlgorithm, SequentialPushRelabel>) {
+                        WHFC_TEST_CHECK(s.rounds == 2 * first[i].rounds && s.pushes == 2 * first[i].pushes && s.relabels == 2 * first[i].relabels);
+                        WHFC_TEST_CHECK(s.edges_scanned == 2 * first[i].edges_scanned && s.active_nodes == 2 * first[i].active_nodes);
+                    } else {
+                        WHFC_TEST_CHECK(s.rounds >= first[i].rounds && s.edges_scanned >= first[i].edges_scanned);
+                    }
+                }
+
+                std::ostringstream json;
+                instrumentation.writeJSON(json, "a\"b\\c\n");
+                WHFC_TEST_CHECK(json.str().rfind("{\"name\":\"a\\\"b\\\\c\\u000a\",\"phases\":[", 0) == 0);
+                WHFC_TEST_CHECK(json.str().find("\"phase\":\"global relabel\"") != std::string::npos);
+                std::ostringstream csv;
+                instrumentation.writeCSV(csv, instance.file);
+                const std::string rows = csv.str();
+                WHFC_TEST_CHECK(std::count(rows.begin(), rows.end(), '\n') == ptrdiff_t(num_push_relabel_phases));
+
+                instrumentation.clear();
+                for (size_t i = 0; i < num_push_relabel_phases; ++i) {
+                    const PushRelabelPhaseStatistics s = instrumentation.statistics(static_cast<PushRelabelPhase>(i));
+                    WHFC_TEST_CHECK(s.rounds == 0 && s.pushes == 0 && s.relabels == 0 && s.edges_scanned == 0 && s.active_nodes == 0);
+                }
+            });
+        }
+
+        template<typename FlowAlgorithm>
+        void maxFlowTest(std::string file, Flow expected_flow, Node s, Node t) {
             FlowHypergraph hg = HMetisIO::readFlowHypergraph(file);
-            ParallelPushRelabel pr(hg);
-            pr.reset();
-            pr.initialize(s, t);
-            Flow f = pr.findMinCuts();
+            FlowAlgorithm fa(hg);
+            Flow f = fa.computeMaxFlow(s, t);
             std::cout << V(file) << " " << V(f) << std::endl;
-
             assert(f == expected_flow);
-            return f == expected_flow;
+            unused(f);
         }
 
-        void flowAlgoTest(std::string file, Flow expected_flow, Node s, Node t) { tryFlowAlgo2(file, expected_flow, s, t); }
+        // max flow with the NUMA-aware reset, twice so that the second run takes the sparse reset
+        template<typename FlowAlgorithm>
+        void numaAwareTest(std::string file, Flow expected_flow, Node s, Node t) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(file);
+            FlowAlgorithm fa(hg);
+            fa.numa_aware = true;
+            for (int i = 0; i < 2; ++i) {
+                Flow f = fa.computeMaxFlow(s, t);
+                std::cout << "numa aware " << V(file) << " " << V(f) << std::endl;
+                assert(f == expected_flow);
+                unused(f);
+            }
+        }
+
+        // layers of different sizes, so that chunks are left partially filled and finalize has to compact
+        void chunkedFrontierTest() {
+            ChunkedFrontier<Node> frontier(0);
+            for (size_t n : { size_t(1), size_t(300), size_t(5000), size_t(100000) }) {
+                frontier.clear();
+                frontier.adapt_capacity(n);
+                frontier.push_back_atomic(Node(0));
+                tbb::parallel_for(tbb::blocked_range<size_t>(1, n, 64), [&](const tbb::blocked_range<size_t>& r) {
+                    auto handle = frontier.local_buffer();
+                    for (size_t i = r.begin(); i < r.end(); ++i) {
+                        handle.push_back(Node(i));
+                    }
+                });
+                frontier.finalize();
+                std::vector<Node> elements(frontier.begin(), frontier.end());
+                std::sort(elements.begin(), elements.end());
+                bool same = elements.size() == n;
+                for (size_t i = 0; same && i < n; ++i) {
+                    same = elements[i] == Node(i);
+                }
+                std::cout << "chunked frontier " << V(n) << " " << V(same) << std::endl;
+                assert(same);
+                unused(same);
+            }
+        }
+
+        void epochBitsetTest() {
+            const size_t n = 1000;
+            EpochBitset bits;
+            bits.words.resize(EpochBitset::numWords(n), 0);
+            bits.clear();
+            std::atomic<size_t> newly_set{ 0 };
+            tbb::parallel_for<size_t>(0, 2 * n, [&](size_t i) {
+                if (i % (2 * 3) < 2 && bits.setAtomic(i / 2)) { // every multiple of 3, twice
+                    newly_set.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            bool correct = newly_set == (n + 2) / 3;
+            bits.reset(3);
+            bits.set(4);
+            for (size_t i = 0; i < n; ++i) {
+                correct &= bits[i] == ((i % 3 == 0 && i != 3) || i == 4);
+            }
+            bits.clear();
+            for (size_t i = 0; i < n; ++i) {
+                correct &= !bits[i];
+            }
+            std::cout << "epoch bitset " << V(correct) << std::endl;
+            assert(correct);
+            unused(correct);
+        }
+
+        template<typename LevelStorage, typename FlowStorage>
+        void pinScanTest() {
+            using Kernel = PinScan<LevelStorage, FlowStorage>;
+            std::mt19937 rng(0);
+            const size_t n = 100;
+            std::vector<LevelStorage> level(n + 1); // a hypernode is never last in the level array
+            std::vector<FlowHypergraph::Pin> pins(Kernel::width);
+            std::vector<FlowStorage> flow(Kernel::width);
+            bool correct = true;
+            for (size_t round = 0; round < 1000; ++round) {
+                for (LevelStorage& l : level) {
+                    l = LevelStorage(rng() % 8);
+                }
+                for (size_t k = 0; k < Kernel::width; ++k) {
+                    pins[k].pin = Node(rng() % n);
+                    flow[k] = FlowStorage(rng() % 3);
+                }
+                const int my_level = int(rng() % 8);
+                for (bool in_node : { false, true }) {
+                    uint32_t expected_admissible = 0;
+                    int expected_level = 100, new_level = 100;
+                    for (size_t k = 0; k < Kernel::width; ++k) {
+                        const int l = level[pins[k].pin];
+                        if (l == my_level - 1) {
+                            expected_admissible |= uint32_t(1) << k;
+                        } else if (l >= my_level && (!in_node || flow[k] > 0)) {
+                            expected_level = std::min(expected_level, l);
+                        }
+                    }
+                    const uint32_t admissible = in_node ? Kernel::template scan<true>(pins.data(), level.data(), flow.data(), my_level, new_level)
+                                                        : Kernel::template scan<false>(pins.data(), level.data(), nullptr, my_level, new_level);
+                    correct &= admissible == expected_admissible && new_level == expected_level;
+                }
+            }
+            std::cout << "pin scan " << V(sizeof(LevelStorage)) << " " << V(sizeof(FlowStorage)) << " " << V(correct) << std::endl;
+            assert(correct);
+            unused(correct);
+        }
+
+        // the snapshot is mapped read-only, so running the engines on it also checks that they never write to the hypergraph
+        void snapshotTest(const Instance& instance) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+            const std::string snapshot_file = (std::filesystem::temp_directory_path() / "whfc_snapshot_test.bin").string();
+            WHFC_IO::WHFCInformation info{ { 5, 6 }, 7, instance.s, instance.t };
+            BinarySnapshotIO::writeSnapshot(hg, &info, snapshot_file);
+            WHFC_TEST_CHECK(BinarySnapshotIO::isSnapshot(snapshot_file) && !BinarySnapshotIO::isSnapshot(instance.file));
+
+            WHFC_IO::WHFCInformation read_info;
+            WHFC_TEST_CHECK(BinarySnapshotIO::readAdditionalInformation(snapshot_file, read_info));
+            WHFC_TEST_CHECK(read_info.s == instance.s && read_info.t == instance.t && read_info.upperFlowBound == 7 && read_info.maxBlockWeight[1] == 6);
+
+            FlowHypergraph mapped = BinarySnapshotIO::readSnapshot(snapshot_file);
+            std::filesystem::remove(snapshot_file); // the mapping stays valid
+            WHFC_TEST_CHECK(mapped.numNodes() == hg.numNodes() && mapped.numHyperedges() == hg.numHyperedges() && mapped.numPins() == hg.numPins());
+            WHFC_TEST_CHECK(mapped.totalNodeWeight() == hg.totalNodeWeight());
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                WHFC_TEST_CHECK(mapped.capacity(e) == hg.capacity(e) && mapped.beginIndexPins(e) == hg.beginIndexPins(e));
+                for (PinIndex i : hg.pinIndices(e)) {
+                    WHFC_TEST_CHECK(mapped.getPin(i) == hg.getPin(i));
+                }
+            }
+            for (Node u : hg.nodeIDs()) {
+                WHFC_TEST_CHECK(mapped.nodeWeight(u) == hg.nodeWeight(u) && mapped.beginIndexHyperedges(u) == hg.beginIndexHyperedges(u));
+            }
+
+            SequentialPushRelabel seq(mapped);
+            WHFC_TEST_CHECK(seq.computeMaxFlow(instance.s, instance.t) == instance.max_flow);
+            ParallelPushRelabel par(mapped);
+            par.reset();
+            par.initialize(instance.s, instance.t);
+            WHFC_TEST_CHECK(par.findMinCuts() && par.flow_value == instance.max_flow);
+        }
+
+        void mappableVectorTest() {
+            MappableVector<int> owned;
+            owned.push_back(1);
+            owned.push_back(2);
+            owned.resize(3);
+            WHFC_TEST_CHECK(!owned.isView() && owned.size() == 3 && owned[1] == 2 && owned[2] == 0);
+
+            int memory[] = { 4, 5, 6 };
+            MappableVector<int> view(memory, 3, nullptr);
+            MappableVector<int> copy = view; // still a view of the same memory
+            WHFC_TEST_CHECK(view.isView() && copy.isView() && copy.data() == memory && view[2] == 6);
+            auto throws = [&](auto&& operation) {
+                try {
+                    operation();
+                } catch (const std::runtime_error&) {
+                    return true;
+                }
+                return false;
+            };
+            WHFC_TEST_CHECK(throws([&] { view.push_back(7); }));
+            WHFC_TEST_CHECK(throws([&] { view.pop_back(); }));
+            WHFC_TEST_CHECK(throws([&] { view.resize(5); }));
+            WHFC_TEST_CHECK(throws([&] { view.clear(); }));
+            WHFC_TEST_CHECK(throws([&] { view.shrink_to_fit(); }));
+            WHFC_TEST_CHECK(view.size() == 3 && view.data() == memory);
+        }
+
+        // compares the incidence arrays with a sequential build. without deterministic order, the incidences of a node are compared as a set
+        static void checkIncidences(const FlowHypergraph& hg, bool deterministic) {
+            std::vector<std::vector<std::pair<Hyperedge, PinIndex>>> expected(hg.numNodes());
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                for (PinIndex i : hg.pinIndices(e)) {
+                    expected[hg.getPin(i).pin].emplace_back(e, i);
+                }
+            }
+            for (Node u : hg.nodeIDs()) {
+                std::vector<std::pair<Hyperedge, PinIndex>> actual;
+                for (InHeIndex i : hg.incidentHyperedgeIndices(u)) {
+                    const FlowHypergraph::InHe& inc = hg.getInHe(i);
+                    WHFC_TEST_CHECK(hg.getPin(inc.pin_iter).pin == u && hg.getPin(inc.pin_iter).he_inc_iter == i);
+                    actual.emplace_back(inc.e, inc.pin_iter);
+                }
+                if (!deterministic) {
+                    std::sort(actual.begin(), actual.end());
+                }
+                WHFC_TEST_CHECK(actual == expected[u]);
+            }
+        }
+
+        // enough pins for many grains of the parallel degree count and incidence fill, built by both constructors
+        void incidenceArraysTest() {
+            std::mt19937 rng(14);
+            const size_t n = 20000, m = 30000;
+            std::vector<NodeWeight> node_weights(n, 1);
+            std::vector<HyperedgeWeight> hyperedge_weights;
+            std::vector<PinIndex> hyperedge_sizes;
+            std::vector<Node> pins;
+            for (size_t e = 0; e < m; ++e) {
+                const size_t size = 2 + rng() % (e % 100 == 0 ? 300 : 8); // a few large hyperedges
+                hyperedge_weights.push_back(1 + rng() % 4);
+                hyperedge_sizes.push_back(PinIndex(size));
+                for (size_t i = 0; i < size; ++i) {
+                    pins.push_back(Node(e % 7 == 0 ? rng() % 50 : rng() % n)); // and high-degree nodes
+                }
+            }
+            tbb::task_arena arena(4);
+            arena.execute([&] {
+                for (bool deterministic : { true, false }) {
+                    FlowHypergraph hg(node_weights, hyperedge_weights, hyperedge_sizes, pins, deterministic);
+                    WHFC_TEST_CHECK(hg.numPins() == pins.size());
+                    checkIncidences(hg, deterministic);
+
+                    FlowHypergraphBuilder builder(n);
+                    size_t pos = 0;
+                    for (size_t e = 0; e < m; ++e) {
+                        builder.startHyperedge(hyperedge_weights[e]);
+                        for (size_t i = 0; i < hyperedge_sizes[e]; ++i) {
+                            builder.addPin(pins[pos++]);
+                        }
+                    }
+                    builder.finalize(deterministic);
+                    checkIncidences(builder, deterministic);
+                }
+            });
+        }
+
+        // the bulk appends must produce the same hypergraph as startHyperedge and addPin
+        void bulkBuilderTest(const Instance& instance) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+            FlowHypergraphBuilder streamed(hg.numNodes()), bulk(hg.numNodes());
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                streamed.startHyperedge(hg.capacity(e));
+                for (const auto& p : hg.pinsOf(e))
+                    streamed.addPin(p.pin);
+            }
+            streamed.finalize();
+
+            // first half from CSR arrays with an additional single-pin hyperedge, second half from a pin generator
+            const size_t half = hg.numHyperedges() / 2;
+            std::vector<Index> offsets;
+            std::vector<Node> pin_ids;
+            std::vector<Flow> capacities;
+            for (Hyperedge e(0); e < half; ++e) {
+                offsets.push_back(pin_ids.size());
+                capacities.push_back(hg.capacity(e));
+                for (const auto& p : hg.pinsOf(e))
+                    pin_ids.push_back(p.pin);
+            }
+            offsets.push_back(pin_ids.size());
+            pin_ids.push_back(Node(0));
+            capacities.push_back(1);
+            offsets.push_back(pin_ids.size());
+            bulk.appendHyperedgesFromCSR(half + 1, offsets, pin_ids, capacities);
+            bulk.appendHyperedges(
+                    hg.numHyperedges() - half, [&](size_t i) { return size_t(hg.pinCount(Hyperedge(half + i))); },
+                    [&](size_t i) { return hg.capacity(Hyperedge(half + i)); },
+                    [&](size_t i, auto&& emit) {
+                        for (const auto& p : hg.pinsOf(Hyperedge(half + i)))
+                            emit(p.pin);
+                    });
+            bulk.finalize();
+
+            WHFC_TEST_CHECK(bulk.numHyperedges() == streamed.numHyperedges() && bulk.numPins() == streamed.numPins());
+            WHFC_TEST_CHECK(bulk.maxHyperedgeCapacity == streamed.maxHyperedgeCapacity);
+            for (Hyperedge e : streamed.hyperedgeIDs()) {
+                WHFC_TEST_CHECK(bulk.capacity(e) == streamed.capacity(e) && bulk.beginIndexPins(e) == streamed.beginIndexPins(e));
+            }
+            for (PinIndex i : streamed.pinIndices()) {
+                WHFC_TEST_CHECK(bulk.getPin(i).pin == streamed.getPin(i).pin && bulk.getPin(i).he_inc_iter == streamed.getPin(i).he_inc_iter);
+            }
+            for (Node u : streamed.nodeIDs()) {
+                WHFC_TEST_CHECK(bulk.beginIndexHyperedges(u) == streamed.beginIndexHyperedges(u));
+            }
+
+            SequentialPushRelabel pr(bulk);
+            WHFC_TEST_CHECK(pr.computeMaxFlow(instance.s, instance.t) == instance.max_flow);
+        }
+
+        // leased instances are reused across jobs on hypergraphs of different sizes, and never shared by two concurrent jobs
+        void poolTest() {
+            HyperFlowCutterPool<SequentialPushRelabel> pool;
+            size_t max_pins = 0;
+            for (const Instance& instance : instances) {
+                max_pins = std::max(max_pins, HMetisIO::readFlowHypergraph(instance.file).numPins());
+            }
+            auto job = [&](size_t i) {
+                const Instance& instance = instances[i % instances.size()];
+                auto lease = pool.acquire(int(i));
+                HMetisIO::readFlowHypergraphWithBuilder(lease.hypergraph(), instance.file);
+                lease.cutter().reset();
+                WHFC_TEST_CHECK(lease.cutter().cs.flow_algo.computeMaxFlow(instance.s, instance.t) == instance.max_flow);
+            };
+            for (size_t i = 0; i < instances.size(); ++i) {
+                job(i); // all reuse the first instance
+            }
+            auto stats = pool.statistics();
+            WHFC_TEST_CHECK(stats.instances_created == 1 && stats.max_in_use == 1 && stats.largest_hypergraph.pins == max_pins);
+
+            tbb::task_arena arena(4);
+            arena.execute([&] { tbb::parallel_for(size_t(0), 4 * instances.size(), job); });
+            stats = pool.statistics();
+            WHFC_TEST_CHECK(stats.acquisitions == 5 * instances.size() && stats.in_use == 0 && stats.max_in_use <= 4);
+            WHFC_TEST_CHECK(stats.instances_created == stats.idle_instances && stats.instances_created <= stats.max_in_use);
+
+            pool.releaseIdleInstances();
+            stats = pool.statistics();
+            WHFC_TEST_CHECK(stats.idle_instances == 0 && stats.largest_hypergraph.pins == 0);
+        }
+
+        void pinningTest(std::string file, Node s, Node t) {
+            // two sockets with two cores of two hardware threads each. CPU i and i + 4 are siblings
+            CpuTopology topology;
+            for (int id = 0; id < 8; ++id) {
+                topology.cpus.push_back({ id, (id % 4) / 2, id % 4, (id % 4) / 2, (id % 4) / 2, id / 4 });
+            }
+            assert((selectCpus(topology, PinningPolicy::Compact, 8) == std::vector<int>{ 0, 1, 4, 5, 2, 3, 6, 7 }));
+            assert((selectCpus(topology, PinningPolicy::Scatter, 4) == std::vector<int>{ 0, 2, 1, 3 }));
+
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(file);
+            const NodeWeight mbw = (hg.totalNodeWeight() + 1) / 2;
+            auto run = [&](tbb::task_arena* arena) {
+                HyperFlowCutter<ParallelPushRelabel> hfc(hg, 42, true);
+                hfc.setArena(arena);
+                hfc.cs.setMaxBlockWeight(0, mbw);
+                hfc.cs.setMaxBlockWeight(1, mbw);
+                hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(s, t);
+                return hfc.cs.flow_algo.flow_value;
+            };
+            const CpuTopology machine = CpuTopology::read();
+            PinnedArena arena(machine, PinningPolicy::Compact, 2);
+            const Flow f = run(&arena.taskArena());
+            std::cout << "pinning " << V(file) << " " << V(machine.cpus.size()) << " " << V(f) << " " << V(arena.failedPins()) << std::endl;
+            assert(f == run(nullptr) && arena.failedPins() == 0);
+            assert(CpuTopology::read().cpus.size() == machine.cpus.size()); // affinity of the calling thread restored
+            unused(f);
+        }
+
+        // all running instances advance in every round. the best instance must be at least as good as a single run with the same seed.
+        // returns the number of instances stopped by the flow of another
+        size_t interleavedTest(const Instance& instance) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+            const NodeWeight mbw = (hg.totalNodeWeight() + 1) / 2;
+            HyperFlowCutter<SequentialPushRelabel> single(hg, 42, true);
+            single.cs.setMaxBlockWeight(0, mbw);
+            single.cs.setMaxBlockWeight(1, mbw);
+            const bool single_found = single.enumerateCutsUntilBalancedOrFlowBoundExceeded(instance.s, instance.t);
+
+            InterleavedHyperFlowCutters<SequentialPushRelabel> multi(hg, 4, 42, true);
+            multi.setMaxBlockWeight(0, mbw);
+            multi.setMaxBlockWeight(1, mbw);
+            tbb::task_arena arena(4);
+            const std::vector<std::pair<Node, Node>> terminals = { { instance.s, instance.t }, { instance.t, instance.s } };
+            const bool found = arena.execute([&] { return multi.runUntilBalancedOrFlowBoundExceeded(terminals); });
+            // instance 0 repeats the single run, so the interleaved run can only be better
+            WHFC_TEST_CHECK(found || !single_found);
+            WHFC_TEST_CHECK(!found || multi.bestInstance().cs.flow_algo.flow_value <= single.cs.flow_algo.flow_value);
+            WHFC_TEST_CHECK(multi.stats.max_steps_per_round == 4 && multi.stats.steps > multi.stats.rounds);
+            if (found) {
+                // the others stopped at the flow of the best cut, or got its bound
+                const Flow best_flow = multi.bestInstance().cs.flow_algo.flow_value;
+                for (size_t i = 0; i < multi.numInstances(); ++i) {
+                    const auto& flow_algo = multi.instance(i).cs.flow_algo;
+                    WHFC_TEST_CHECK(flow_algo.flow_value >= best_flow || flow_algo.upper_flow_bound < best_flow);
+                }
+            }
+            return multi.stats.cut_off;
+        }
+
+        template<typename FlowAlgorithm>
+        static std::pair<bool, Flow> balancedCut(FlowHypergraph& hg, const Instance& instance, NodeWeight mbw) {
+            HyperFlowCutter<FlowAlgorithm> hfc(hg, 42, true);
+            hfc.cs.setMaxBlockWeight(0, mbw);
+            hfc.cs.setMaxBlockWeight(1, mbw);
+            const bool found = hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(instance.s, instance.t);
+            return { found, hfc.cs.flow_algo.flow_value };
+        }
+
+        // the prior picks the sequential engine for small problems, then the other engine is explored. every run must give the cut
+        // of a plain HyperFlowCutter with the chosen engine
+        void engineSelectionTest(const Instance& instance) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+            const FlowProblemFeatures features = FlowProblemFeatures::compute(hg);
+            FlowEngineSelector selector;
+            selector.single_thread_exploration = true;
+            WHFC_TEST_CHECK(selector.select(features) == FlowEngine::Sequential);
+            selector.record(features, FlowEngine::Sequential, 2.0);
+            WHFC_TEST_CHECK(selector.select(features) == FlowEngine::Parallel);
+            selector.record(features, FlowEngine::Parallel, 1.0);
+            WHFC_TEST_CHECK(selector.select(features) == FlowEngine::Parallel); // faster
+            selector.record(features, FlowEngine::Parallel, 100.0);
+            WHFC_TEST_CHECK(selector.select(features) == FlowEngine::Sequential); // the average caught up
+
+            const NodeWeight mbw = (hg.totalNodeWeight() + 1) / 2;
+            const auto sequential = balancedCut<SequentialPushRelabel>(hg, instance, mbw);
+            const auto parallel = balancedCut<ParallelPushRelabel>(hg, instance, mbw);
+            FlowEngineSelector fresh;
+            fresh.single_thread_exploration = true;
+            AdaptiveHyperFlowCutter hfc(hg, 42, fresh, true);
+            hfc.setMaxBlockWeight(0, mbw);
+            hfc.setMaxBlockWeight(1, mbw);
+            for (FlowEngine expected : { FlowEngine::Sequential, FlowEngine::Parallel }) {
+                const bool found = hfc.enumerateCutsUntilBalancedOrFlowBoundExceeded(instance.s, instance.t);
+                WHFC_TEST_CHECK(hfc.lastEngine() == expected && fresh.samples(features, expected) == 1);
+                const auto& reference = expected == FlowEngine::Sequential ? sequential : parallel;
+                WHFC_TEST_CHECK(found == reference.first && hfc.flowValue() == reference.second);
+            }
+        }
+
+        void warmStartTest() {
+            for (const Instance& instance : instances) {
+                FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+                ParallelPushRelabel pr(hg);
+                WHFC_TEST_CHECK(pr.computeMaxFlow(instance.s, instance.t) == instance.max_flow);
+                FlowAssignment fa;
+                pr.exportFlow(fa);
+
+                std::vector<Node> node_mapping;
+                for (Node u : hg.nodeIDs())
+                    node_mapping.push_back(u);
+                std::vector<Hyperedge> hyperedge_mapping;
+                for (Hyperedge e : hg.hyperedgeIDs())
+                    hyperedge_mapping.push_back(e);
+
+                pr.reset();
+                pr.initialize(instance.s, instance.t);
+                pr.importFlow(fa, node_mapping, hyperedge_mapping);
+                WHFC_TEST_CHECK(pr.flow_value == instance.max_flow && "warm start with identity mapping keeps the whole flow");
+                pr.augmentFlow();
+                WHFC_TEST_CHECK(pr.flow_value == instance.max_flow);
+            }
+        }
+
+        // the next flow problem drops a node and a hyperedge, which shifts the IDs of all later ones
+        void warmStartMappingTest(const Instance& instance, Node dropped_node, Hyperedge dropped_edge) {
+            FlowHypergraph hg = HMetisIO::readFlowHypergraph(instance.file);
+            ParallelPushRelabel pr(hg);
+            pr.computeMaxFlow(instance.s, instance.t);
+            FlowAssignment fa;
+            pr.exportFlow(fa);
+
+            std::vector<Node> node_mapping;
+            for (Node u : hg.nodeIDs()) {
+                node_mapping.push_back(u == dropped_node ? invalidNode : Node(u < dropped_node ? u : u - 1));
+            }
+            FlowHypergraphBuilder next(hg.numNodes() - 1);
+            std::vector<Hyperedge> hyperedge_mapping;
+            Hyperedge next_e(0);
+            for (Hyperedge e : hg.hyperedgeIDs()) {
+                size_t remaining_pins = 0;
+                for (const auto& p : hg.pinsOf(e)) {
+                    remaining_pins += node_mapping[p.pin] != invalidNode;
+                }
+                if (e == dropped_edge || remaining_pins < 2) { // the builder drops hyperedges with less than two pins
+                    hyperedge_mapping.push_back(invalidHyperedge);
+                    continue;
+                }
+                next.startHyperedge(hg.capacity(e));
+                for (const auto& p : hg.pinsOf(e)) {
+                    if (node_mapping[p.pin] != invalidNode) {
+                        next.addPin(node_mapping[p.pin]);
+                    }
+                }
+                hyperedge_mapping.push_back(next_e++);
+            }
+            next.finalize();
+            WHFC_TEST_CHECK(next.numHyperedges() == next_e);
+
+            const Node s = node_mapping[instance.s], t = node_mapping[instance.t];
+            ParallelPushRelabel warm(next);
+            warm.reset();
+            warm.initialize(s, t);
+            warm.importFlow(fa, node_mapping, hyperedge_mapping);
+            bool valid_preflow = true;
+            for (int i = 0; i < warm.max_level; ++i) {
+                valid_preflow &= warm.excess[i] >= 0 || warm.isSource(Node(i));
+            }
+            WHFC_TEST_CHECK(valid_preflow);
+            const Flow imported = warm.flow_value;
+            warm.augmentFlow();
+
+            ParallelPushRelabel cold(next);
+            const Flow expected = cold.computeMaxFlow(s, t);
+            WHFC_TEST_CHECK(warm.flow_value == expected);
+            // most of the flow survives the mapping, so the warm start does real work
+            WHFC_TEST_CHECK(imported > 0 && imported <= expected && expected > instance.max_flow / 2);
+        }
 
         void run() {
-            flowAlgoTest("../test_hypergraphs/testhg.hgr", Flow(1), Node(14), Node(10));
-            flowAlgoTest("../test_hypergraphs/twocenters.hgr", Flow(2), Node(0), Node(2));
-            flowAlgoTest("../test_hypergraphs/twocenters.hgr", Flow(2), Node(0), Node(3));
-            flowAlgoTest("../test_hypergraphs/push_back.hgr", Flow(6), Node(0), Node(7));
+            minCutTest<ParallelPushRelabel>();
+            sparseResetTest<SequentialPushRelabel>();
+            sparseResetTest<ParallelPushRelabel>();
+            compactStorageTest<CompactSequentialPushRelabel, SequentialPushRelabel>();
+            compactStorageTest<CompactParallelPushRelabel, ParallelPushRelabel>();
+            compactStorageTest<CompactAsyncPushRelabel, AsyncPushRelabel>();
+            directionOptimizingBFSTest();
+            parallelTargetSideCutTest();
+            sequentialFallbackTest();
+            asyncTest();
+            highestLabelTest();
+            excessScalingTest();
+            augmentingPathTest();
+            instrumentationTest<SequentialPushRelabel>();
+            instrumentationTest<ParallelPushRelabel>();
+            instrumentationTest<AsyncPushRelabel>();
+            numaAwareTest<ParallelPushRelabel>("../test_hypergraphs/push_back.hgr", Flow(6), Node(0), Node(7));
+            numaAwareTest<AsyncPushRelabel>("../test_hypergraphs/testhg.hgr", Flow(1), Node(14), Node(10));
+            chunkedFrontierTest();
+            epochBitsetTest();
+            pinScanTest<int, Flow>();
+            pinScanTest<int16_t, int16_t>();
+            for (const Instance& instance : instances) {
+                snapshotTest(instance);
+            }
+            mappableVectorTest();
+            incidenceArraysTest();
+            for (const Instance& instance : instances) {
+                bulkBuilderTest(instance);
+            }
+            poolTest();
+            size_t cut_off = 0;
+            for (const Instance& instance : instances) {
+                cut_off += interleavedTest(instance);
+            }
+            WHFC_TEST_CHECK(cut_off > 0);
+            pinningTest("../test_hypergraphs/push_back.hgr", Node(0), Node(7));
+            for (const Instance& instance : instances) {
+                engineSelectionTest(instance);
+            }
+            warmStartTest();
+            const Instance& large = instances.back();
+            warmStartMappingTest(large, Node(5), Hyperedge(0));
+            warmStartMappingTest(large, Node(1), Hyperedge(300)); // the node after s
+            warmStartMappingTest(large, Node(398), Hyperedge(603)); // the last hyperedge and the node before t
         }
     };
 } // namespace whfc::Test
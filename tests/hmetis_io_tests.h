@@ -0,0 +1,151 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "../io/hmetis_io.h"
+#include "test_check.h"
+
+namespace whfc::Test {
+
+    class HMetisIOTests {
+    public:
+        using Parsed = HMetisParser::ParsedHypergraph;
+
+        // the istringstream-based reading that HMetisParser replaced, with the validation of readFlowHypergraph (remove_single_pin_hyperedges)
+        // or of readFlowHypergraphWithBuilder
+        static Parsed parseLineByLine(const std::string& filename, bool remove_single_pin_hyperedges) {
+            std::ifstream f(filename);
+            if (!f)
+                throw std::runtime_error("File: " + filename + " not found.");
+            auto [numNodes, numHEs, hg_type] = HMetisIO::readHeader(f);
+            Parsed res;
+            res.num_nodes = numNodes;
+            res.num_hyperedges = numHEs;
+            res.type = hg_type;
+            const bool hasHyperedgeWeights = hg_type == HMetisIO::HGType::EdgeAndNodeWeights || hg_type == HMetisIO::HGType::EdgeWeights;
+            const bool hasNodeWeights = hg_type == HMetisIO::HGType::EdgeAndNodeWeights || hg_type == HMetisIO::HGType::NodeWeights;
+
+            std::string line;
+            auto mgetline = [&] {
+                std::getline(f, line);
+                while (line[0] == '%') {
+                    std::getline(f, line);
+                }
+            };
+
+            for (size_t e = 0; e < numHEs; ++e) {
+                mgetline();
+                std::istringstream iss(line);
+                uint32_t pin;
+                uint32_t he_size = 0;
+                uint32_t he_weight = 1;
+                if (hasHyperedgeWeights)
+                    iss >> he_weight;
+                while (iss >> pin) {
+                    if (pin < 1)
+                        throw std::runtime_error("File: " + filename + " has pin id < 1 (in one-based ids).");
+                    if (pin > numNodes)
+                        throw std::runtime_error("File: " + filename + " has pin id > number of nodes.");
+                    he_size++;
+                    res.pins.emplace_back(pin - 1);
+                }
+                if (he_size <= 1 && !remove_single_pin_hyperedges)
+                    throw std::runtime_error("File: " + filename + " has pin with zero or one pins.");
+                if (he_size > numNodes && remove_single_pin_hyperedges)
+                    throw std::runtime_error("File: " + filename + " has hyperedge with more pins than nodes in the hypergraph.");
+                if (he_size == 0)
+                    throw std::runtime_error("File: " + filename + " has hyperedge with zero pins.");
+                if (he_size == 1) {
+                    res.pins.pop_back();
+                } else {
+                    res.hyperedge_weights.emplace_back(he_weight);
+                    res.hyperedge_sizes.emplace_back(he_size);
+                }
+            }
+
+            res.node_weights.resize(numNodes, NodeWeight(1));
+            if (hasNodeWeights) {
+                for (size_t u = 0; u < numNodes; ++u) {
+                    mgetline();
+                    std::istringstream iss(line);
+                    iss >> res.node_weights[u];
+                }
+            }
+            return res;
+        }
+
+        static std::string writeFile(const std::string& name, const std::string& contents) {
+            const std::string filename = (std::filesystem::temp_directory_path() / name).string();
+            std::ofstream f(filename, std::ios::binary);
+            f << contents;
+            return filename;
+        }
+
+        template<typename F>
+        static bool throws(F&& f) {
+            try {
+                f();
+            } catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        }
+
+        // both readers must produce the same arrays, or both must reject the file. returns in how many modes the file was accepted
+        static size_t compareWithLineByLine(const std::string& filename) {
+            size_t accepted = 0;
+            for (bool remove_single_pin_hyperedges : { false, true }) {
+                Parsed expected;
+                if (throws([&] { expected = parseLineByLine(filename, remove_single_pin_hyperedges); })) {
+                    WHFC_TEST_CHECK(throws([&] { HMetisParser::parse(filename, remove_single_pin_hyperedges); }));
+                    continue;
+                }
+                const Parsed p = HMetisParser::parse(filename, remove_single_pin_hyperedges);
+                WHFC_TEST_CHECK(p.num_nodes == expected.num_nodes && p.num_hyperedges == expected.num_hyperedges && p.type == expected.type);
+                WHFC_TEST_CHECK(p.node_weights == expected.node_weights);
+                WHFC_TEST_CHECK(p.hyperedge_weights == expected.hyperedge_weights);
+                WHFC_TEST_CHECK(p.hyperedge_sizes == expected.hyperedge_sizes);
+                WHFC_TEST_CHECK(p.pins == expected.pins);
+                accepted++;
+            }
+            return accepted;
+        }
+
+        void run() {
+            for (const std::string file : { "testhg.hgr", "twocenters.hgr", "push_back.hgr", "large_nets.hgr" }) {
+                WHFC_TEST_CHECK(compareWithLineByLine("../test_hypergraphs/" + file) == 2);
+            }
+
+            std::vector<std::string> files;
+            // single-pin hyperedges, comments, tabs and trailing garbage
+            files.push_back(writeFile("whfc_hmetis_unweighted.hgr", "% comment\n5 4\n1 2\n3\n%another comment\n2\t3 4\n4 % trailing comment\n1 4 2 xyz\n"));
+            // CRLF line endings everywhere
+            files.push_back(writeFile("whfc_hmetis_crlf.hgr", "%c\r\n3 4 1\r\n7 1 2\r\n2 3\r\n5 2 3 4\r\n"));
+            files.push_back(writeFile("whfc_hmetis_node_weights.hgr", "2 3 10\r\n1 2\r\n%c\r\n2 3 1\r\n4\r\n1\r\n9\r\n"));
+            files.push_back(writeFile("whfc_hmetis_both_weights.hgr", "3 3 11\n2 1 2\n% c\n3 3\n4 3 1\n5\n%c\n6\n7"));
+            // more pins than nodes, which only readFlowHypergraph rejects
+            files.push_back(writeFile("whfc_hmetis_repeated_pins.hgr", "1 2\n1 2 1\n"));
+            for (const std::string& file : files) {
+                WHFC_TEST_CHECK(compareWithLineByLine(file) > 0);
+            }
+            WHFC_TEST_CHECK(throws([&] { HMetisIO::readFlowHypergraph(files.back()); }));
+            WHFC_TEST_CHECK(HMetisIO::readFlowHypergraphWithBuilder(files.back()).numPins() == 3);
+
+            // integers that overflow 64 bits or the type they are stored in
+            for (const std::string contents : { "1 2\n1 99999999999999999999999\n", "1 2 1\n4294967296 1 2\n", "1 4294967296\n1 2\n",
+                                                "1 2 10\n1 2\n1\n18446744073709551616\n", "1 2 256\n1 2\n" }) {
+                const std::string file = writeFile("whfc_hmetis_overflow.hgr", contents);
+                WHFC_TEST_CHECK(throws([&] { HMetisParser::parse(file, true); }));
+                files.push_back(file);
+            }
+
+            for (const std::string& file : files) {
+                std::filesystem::remove(file);
+            }
+        }
+    };
+
+} // namespace whfc::Test
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// unlike assert, also checked in release builds, which is how the tests are run
+#define WHFC_TEST_CHECK(condition)                                                                                                   \
+    do {                                                                                                                             \
+        if (!(condition)) {                                                                                                          \
+            throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": check failed: " #condition);        \
+        }                                                                                                                            \
+    } while (false)
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace whfc {
+
+    /*
+     * The CPUs this process may run on, i.e., its affinity mask, which reflects cgroup cpusets and taskset, and for each of them
+     * the socket, physical core, NUMA node and shared last-level cache, read from sysfs. Missing sysfs entries default to a single socket,
+     * node and cache with one core per CPU. On other systems, the CPUs are 0 .. hardware_concurrency - 1 without topology.
+     */
+    class CpuTopology {
+    public:
+        struct Cpu {
+            int id = 0;
+            int package = 0, core = 0, numa_node = 0, last_level_cache = 0;
+            int smt_rank = 0; // position among the hardware threads of its core, 0 for the first
+        };
+
+        std::vector<Cpu> cpus;
+
+        static CpuTopology read() {
+            CpuTopology topology;
+            for (int id : allowedCpus()) {
+                Cpu c;
+                c.id = id;
+                const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+                c.package = readInt(dir + "/topology/physical_package_id", 0);
+                c.core = readInt(dir + "/topology/core_id", id);
+                c.numa_node = numaNodeOf(id);
+                c.last_level_cache = lastLevelCacheOf(dir, id);
+                topology.cpus.push_back(c);
+            }
+            for (Cpu& c : topology.cpus) {
+                c.smt_rank = int(std::count_if(topology.cpus.begin(), topology.cpus.end(), [&](const Cpu& o) {
+                    return o.package == c.package && o.core == c.core && o.id < c.id;
+                }));
+            }
+            return topology;
+        }
+
+        std::vector<int> packages() const {
+            std::vector<int> res;
+            for (const Cpu& c : cpus) {
+                res.push_back(c.package);
+            }
+            std::sort(res.begin(), res.end());
+            res.erase(std::unique(res.begin(), res.end()), res.end());
+            return res;
+        }
+
+        // sysfs lists of CPUs or nodes, e.g. "0-3,8-11"
+        static std::vector<int> parseList(const std::string& list) {
+            std::vector<int> res;
+            std::stringstream ss(list);
+            std::string range;
+            while (std::getline(ss, range, ',')) {
+                const size_t dash = range.find('-');
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int x = first; x <= last; ++x) {
+                    res.push_back(x);
+                }
+            }
+            return res;
+        }
+
+        size_t numPhysicalCores() const {
+            return size_t(std::count_if(cpus.begin(), cpus.end(), [](const Cpu& c) { return c.smt_rank == 0; }));
+        }
+
+    private:
+        static std::vector<int> allowedCpus() {
+            std::vector<int> res;
+#ifdef __linux__
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+                for (int id = 0; id < CPU_SETSIZE; ++id) {
+                    if (CPU_ISSET(id, &mask)) {
+                        res.push_back(id);
+                    }
+                }
+            }
+#endif
+            if (res.empty()) {
+                for (int id = 0; id < int(std::max(1U, std::thread::hardware_concurrency())); ++id) {
+                    res.push_back(id);
+                }
+            }
+            return res;
+        }
+
+        static int readInt(const std::string& path, int default_value) {
+            std::ifstream f(path);
+            int x;
+            return f >> x ? x : default_value;
+        }
+
+        // node IDs may be sparse, so walk the online nodes instead of probing node0, node1, ...
+        static int numaNodeOf(int id) {
+            for (int node : parseList(readLine("/sys/devices/system/node/online"))) {
+                const std::vector<int> node_cpus = parseList(readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+                if (std::find(node_cpus.begin(), node_cpus.end(), id) != node_cpus.end()) {
+                    return node;
+                }
+            }
+            return 0;
+        }
+
+        // identified by the smallest CPU sharing the highest cache level
+        static int lastLevelCacheOf(const std::string& cpu_dir, int id) {
+            std::string shared;
+            for (int index = 0; std::ifstream(cpu_dir + "/cache/index" + std::to_string(index) + "/shared_cpu_list"); ++index) {
+                shared = readLine(cpu_dir + "/cache/index" + std::to_string(index) + "/shared_cpu_list");
+            }
+            return shared.empty() ? id : std::stoi(shared);
+        }
+
+        static std::string readLine(const std::string& path) {
+            std::ifstream f(path);
+            std::string line;
+            std::getline(f, line);
+            return line;
+        }
+    };
+
+} // namespace whfc
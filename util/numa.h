@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <string>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/scalable_allocator.h>
+#include <type_traits>
+#include <vector>
+
+#include "cpu_topology.h"
+#include "unused.h"
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace whfc {
+
+    // scalable_allocator that default-initializes instead of value-initializing, so that resize() without a value does not write to the new
+    // elements. lets their pages be first touched by the threads that work on them later
+    template<typename T>
+    class first_touch_allocator : public tbb::scalable_allocator<T> {
+    public:
+        template<typename U>
+        struct rebind {
+            using other = first_touch_allocator<U>;
+        };
+
+        first_touch_allocator() = default;
+        template<typename U>
+        first_touch_allocator(const first_touch_allocator<U>&) noexcept {}
+
+        template<typename U>
+        void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+            ::new (static_cast<void*>(p)) U;
+        }
+        template<typename U, typename... Args>
+        void construct(U* p, Args&&... args) {
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+    };
+
+    template<typename T>
+    using first_touch_vec = std::vector<T, first_touch_allocator<T>>;
+
+    /*
+     * Memory placement on multi-socket machines. Linux places a page on the socket of the thread that first writes to it,
+     * so arrays that are initialized by a single thread end up on one socket.
+     * firstTouchResize initializes arrays in parallel with the static partitioning of the node-indexed loops of the parallel engines,
+     * and interleave() spreads pages of shared buffers round-robin over all sockets. Both are no-ops in effect on single-socket machines,
+     * and interleave() does nothing on other systems. Memory that the scalable allocator hands out again keeps its placement.
+     */
+    class NUMA {
+    public:
+        static size_t numNodes() { return onlineNodes().size(); }
+
+        // sets the interleave policy for the whole pages in [p, p + bytes) and moves pages that were already touched
+        static void interleave(void* p, size_t bytes) {
+#ifdef __linux__
+            const std::vector<unsigned long>& nodes = onlineNodes();
+            if (nodes.size() < 2) {
+                return;
+            }
+            const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            const size_t begin = (reinterpret_cast<size_t>(p) + page_size - 1) / page_size * page_size;
+            const size_t end = (reinterpret_cast<size_t>(p) + bytes) / page_size * page_size;
+            if (begin >= end) {
+                return;
+            }
+            constexpr size_t bits = 8 * sizeof(unsigned long);
+            const unsigned long max_node = nodes.back() + 1;
+            std::vector<unsigned long> mask((max_node + bits - 1) / bits, 0);
+            for (unsigned long u : nodes) {
+                mask[u / bits] |= 1UL << (u % bits);
+            }
+            // failures (no permission, kernel without NUMA) leave the default policy
+            ::syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, mask.data(), max_node + 1, MPOL_MF_MOVE);
+#else
+            unused(p, bytes);
+#endif
+        }
+
+    private:
+        static const std::vector<unsigned long>& onlineNodes() {
+            static const std::vector<unsigned long> nodes = [] {
+                std::ifstream f("/sys/devices/system/node/online");
+                std::string list;
+                std::getline(f, list);
+                std::vector<unsigned long> res;
+                for (int u : CpuTopology::parseList(list)) {
+                    res.push_back(static_cast<unsigned long>(u));
+                }
+                if (res.empty()) {
+                    res.push_back(0);
+                }
+                return res;
+            }();
+            return nodes;
+        }
+    };
+
+    // like v.resize(n, value), but the new elements are written in parallel. if v has to grow, it moves to fresh memory whose pages
+    // are all first touched in parallel, including the copied old elements
+    template<typename T>
+    void firstTouchResize(first_touch_vec<T>& v, size_t n, const T value) {
+        if (n <= v.capacity()) {
+            const size_t old_size = v.size();
+            v.resize(n);
+            if (n > old_size) {
+                tbb::parallel_for(
+                        tbb::blocked_range<size_t>(old_size, n), [&](const tbb::blocked_range<size_t>& r) { std::fill(v.begin() + r.begin(), v.begin() + r.end(), value); },
+                        tbb::static_partitioner());
+            }
+            return;
+        }
+        first_touch_vec<T> fresh;
+        fresh.reserve(n);
+        fresh.resize(n);
+        tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, n),
+                [&](const tbb::blocked_range<size_t>& r) {
+                    for (size_t i = r.begin(); i < r.end(); ++i) {
+                        fresh[i] = i < v.size() ? v[i] : value;
+                    }
+                },
+                tbb::static_partitioner());
+        v.swap(fresh);
+    }
+
+    // like v.assign(n, value), with all elements written in parallel
+    template<typename T>
+    void firstTouchAssign(first_touch_vec<T>& v, size_t n, const T value) {
+        if (n > v.capacity()) {
+            first_touch_vec<T>().swap(v); // so that firstTouchResize does not copy
+        }
+        v.resize(std::min(v.size(), n));
+        tbb::parallel_for(
+                tbb::blocked_range<size_t>(0, v.size()), [&](const tbb::blocked_range<size_t>& r) { std::fill(v.begin() + r.begin(), v.begin() + r.end(), value); },
+                tbb::static_partitioner());
+        firstTouchResize(v, n, value);
+    }
+
+    // resize with the interleave policy set before the new pages are touched
+    template<typename T, typename Allocator>
+    void interleavedResize(std::vector<T, Allocator>& v, size_t n) {
+        if (n <= v.capacity()) {
+            v.resize(n);
+            return;
+        }
+        std::vector<T, Allocator> fresh;
+        fresh.reserve(n);
+        NUMA::interleave(fresh.data(), n * sizeof(T));
+        fresh.assign(v.begin(), v.end());
+        fresh.resize(n);
+        v.swap(fresh);
+    }
+
+} // namespace whfc
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace whfc {
+
+    // instructions and cache misses of the calling thread, read via perf_event. not available on other systems, in containers without
+    // perf_event access, or with perf_event_paranoid > 2, in which case read() reports available = false
+    class PerfCounters {
+    public:
+        struct Values {
+            bool available = false;
+            uint64_t instructions = 0, cache_misses = 0;
+        };
+
+        // counters of the calling thread, opened on first use
+        static PerfCounters& threadLocal() {
+            static thread_local PerfCounters counters;
+            return counters;
+        }
+
+        Values read() const {
+            Values v;
+#ifdef __linux__
+            if (fd_instructions >= 0 && fd_cache_misses >= 0) {
+                v.available = readCounter(fd_instructions, v.instructions) && readCounter(fd_cache_misses, v.cache_misses);
+            }
+#endif
+            return v;
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        ~PerfCounters() {
+#ifdef __linux__
+            if (fd_instructions >= 0)
+                ::close(fd_instructions);
+            if (fd_cache_misses >= 0)
+                ::close(fd_cache_misses);
+#endif
+        }
+
+    private:
+        PerfCounters() {
+#ifdef __linux__
+            fd_instructions = open(PERF_COUNT_HW_INSTRUCTIONS);
+            fd_cache_misses = open(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+        }
+
+#ifdef __linux__
+        static int open(uint64_t config) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0 /* calling thread */, -1 /* any cpu */, -1, 0));
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+            return fd;
+        }
+
+        static bool readCounter(int fd, uint64_t& value) { return ::read(fd, &value, sizeof(value)) == sizeof(value); }
+#endif
+
+        int fd_instructions = -1, fd_cache_misses = -1;
+    };
+
+} // namespace whfc
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_scan.h>
+
+namespace whfc {
+
+    // exclusive prefix sum over value(0), ..., value(n - 1). calls write(i, value(0) + ... + value(i - 1)) and returns the total.
+    // value(i) is read before write(i, ...) is called, so both may refer to the same entry
+    template<typename T, typename ValueFunc, typename WriteFunc>
+    T parallelPrefixSum(size_t n, ValueFunc&& value, WriteFunc&& write, size_t grain_size = 1 << 14) {
+        return tbb::parallel_scan(
+                tbb::blocked_range<size_t>(0, n, grain_size), T(0),
+                [&](const tbb::blocked_range<size_t>& r, T sum, bool is_final_scan) {
+                    for (size_t i = r.begin(); i < r.end(); ++i) {
+                        const T x = value(i);
+                        if (is_final_scan) {
+                            write(i, sum);
+                        }
+                        sum += x;
+                    }
+                    return sum;
+                },
+                std::plus<T>());
+    }
+
+} // namespace whfc
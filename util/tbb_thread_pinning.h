@@ -1,30 +1,158 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <iostream>
+#include <memory>
+#include <tbb/task_arena.h>
 #include <tbb/task_scheduler_observer.h>
-#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "cpu_topology.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 namespace whfc {
 
-    class pinning_observer : public tbb::task_scheduler_observer {
-        size_t ncpus;
+    /*
+     * Which of the allowed CPUs the threads of an arena are pinned to, in the order of the arena slots.
+     * Compact fills one socket after the other, first one hardware thread per physical core, then the SMT siblings, so that the threads
+     * share caches. Scatter alternates between the sockets, again physical cores first, to maximize the memory bandwidth.
+     */
+    enum class PinningPolicy : uint8_t { Compact, Scatter };
+
+    inline std::vector<int> selectCpus(const CpuTopology& topology, PinningPolicy policy, size_t num_threads) {
+        std::vector<CpuTopology::Cpu> cpus = topology.cpus;
+        auto compact_order = [](const CpuTopology::Cpu& a, const CpuTopology::Cpu& b) {
+            return std::tie(a.package, a.smt_rank, a.numa_node, a.last_level_cache, a.core, a.id) <
+                   std::tie(b.package, b.smt_rank, b.numa_node, b.last_level_cache, b.core, b.id);
+        };
+        std::sort(cpus.begin(), cpus.end(), compact_order);
+        if (policy == PinningPolicy::Scatter) {
+            // rank within the package in compact order, then round-robin over the packages
+            std::vector<std::pair<size_t, CpuTopology::Cpu>> ranked;
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                const size_t rank = size_t(std::count_if(cpus.begin(), cpus.begin() + i, [&](const auto& c) { return c.package == cpus[i].package; }));
+                ranked.emplace_back(rank, cpus[i]);
+            }
+            std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (size_t i = 0; i < ranked.size(); ++i) {
+                cpus[i] = ranked[i].second;
+            }
+        }
+        std::vector<int> res;
+        for (size_t i = 0; i < std::min(num_threads, cpus.size()); ++i) {
+            res.push_back(cpus[i].id);
+        }
+        return res;
+    }
 
+    /*
+     * Pins the threads that join the observed arena to the given CPUs, slot i to cpus[i % cpus.size()], and restores their previous affinity
+     * when they leave, so that the calling thread and TBB workers are not left pinned for other arenas.
+     * Pinning failures are counted instead of aborting, e.g., if a CPU was removed from the cpuset in the meantime.
+     */
+    class pinning_observer : public tbb::task_scheduler_observer {
     public:
-        pinning_observer() : ncpus(std::thread::hardware_concurrency()) {}
+        pinning_observer(tbb::task_arena& arena, std::vector<int> cpus) : tbb::task_scheduler_observer(arena), cpus(std::move(cpus)) {}
+
+        ~pinning_observer() { observe(false); }
 
-        void on_scheduler_entry(bool) {
-            const size_t size = CPU_ALLOC_SIZE(ncpus);
-            int slot = tbb::this_task_arena::current_thread_index();
+        void on_scheduler_entry(bool) override {
+#ifdef __linux__
+            cpu_set_t previous;
+            CPU_ZERO(&previous);
+            const bool has_previous = sched_getaffinity(0, sizeof(previous), &previous) == 0;
+            saved_masks().push_back({ previous, has_previous });
+
+            const int slot = tbb::this_task_arena::current_thread_index();
+            if (cpus.empty() || slot < 0) {
+                return;
+            }
             cpu_set_t target_mask;
             CPU_ZERO(&target_mask);
-            CPU_SET(slot, &target_mask);
-            const int err = sched_setaffinity(0, size, &target_mask);
-            if (err) {
-                std::cout << "Failed to set thread affinity" << std::endl;
-                std::exit(EXIT_FAILURE);
+            CPU_SET(cpus[size_t(slot) % cpus.size()], &target_mask);
+            if (sched_setaffinity(0, sizeof(target_mask), &target_mask) != 0) {
+                failed_pins.fetch_add(1, std::memory_order_relaxed);
             }
+#endif
         }
+
+        void on_scheduler_exit(bool) override {
+#ifdef __linux__
+            auto& masks = saved_masks();
+            if (!masks.empty()) {
+                if (masks.back().valid) {
+                    sched_setaffinity(0, sizeof(masks.back().mask), &masks.back().mask);
+                }
+                masks.pop_back();
+            }
+#endif
+        }
+
+        size_t failedPins() const { return failed_pins.load(std::memory_order_relaxed); }
+
+    private:
+#ifdef __linux__
+        struct SavedMask {
+            cpu_set_t mask;
+            bool valid;
+        };
+        // a stack, since a thread can enter nested arenas
+        static std::vector<SavedMask>& saved_masks() {
+            static thread_local std::vector<SavedMask> masks;
+            return masks;
+        }
+#endif
+
+        std::vector<int> cpus;
+        std::atomic<size_t> failed_pins{ 0 };
+    };
+
+    /*
+     * A task_arena with one slot per selected CPU whose threads are pinned to them. Run HyperFlowCutter or the flow algorithms inside
+     * via execute(), or hand the arena to HyperFlowCutter::setArena, so that several jobs on one machine use disjoint cores.
+     */
+    class PinnedArena {
+    public:
+        explicit PinnedArena(std::vector<int> cpus) :
+            cpus(std::move(cpus)), arena(int(std::max<size_t>(this->cpus.size(), 1))), observer(arena, this->cpus) {
+            observer.observe(true);
+        }
+
+        PinnedArena(const CpuTopology& topology, PinningPolicy policy, size_t num_threads) : PinnedArena(selectCpus(topology, policy, num_threads)) {}
+
+        // one arena per socket with all allowed CPUs of that socket, physical cores first
+        static std::vector<std::unique_ptr<PinnedArena>> perSocket(const CpuTopology& topology) {
+            std::vector<std::unique_ptr<PinnedArena>> res;
+            const std::vector<int> compact = selectCpus(topology, PinningPolicy::Compact, topology.cpus.size());
+            for (int package : topology.packages()) {
+                std::vector<int> socket_cpus;
+                for (int id : compact) {
+                    if (std::any_of(topology.cpus.begin(), topology.cpus.end(), [&](const auto& c) { return c.id == id && c.package == package; })) {
+                        socket_cpus.push_back(id);
+                    }
+                }
+                res.push_back(std::make_unique<PinnedArena>(std::move(socket_cpus)));
+            }
+            return res;
+        }
+
+        template<typename F>
+        auto execute(F&& f) {
+            return arena.execute(std::forward<F>(f));
+        }
+
+        tbb::task_arena& taskArena() { return arena; }
+        const std::vector<int>& pinnedCpus() const { return cpus; }
+        size_t failedPins() const { return observer.failedPins(); }
+
+    private:
+        std::vector<int> cpus;
+        tbb::task_arena arena;
+        pinning_observer observer;
     };
 
 } // namespace whfc